@@ -0,0 +1,38 @@
+#include "BatchController.hpp"
+
+#include <algorithm>
+
+
+BatchController::BatchController(BatchPolicy policy, size_t batch_size)
+    : policy_(policy),
+      batch_size_(policy == BatchPolicy::Adaptive ? std::clamp(batch_size, MIN_BATCH, MAX_BATCH) : batch_size) {
+}
+
+size_t BatchController::get(size_t pool_depth) const {
+    return std::min(batch_size_, pool_depth);
+}
+
+void BatchController::add_sample(uint64_t latency, size_t pool_depth) {
+    if (policy_ != BatchPolicy::Adaptive) {
+        return;
+    }
+
+    static const double ALPHA = 1.0 / 8;
+    static const double LATENCY_SLACK = 1.5;
+
+    double sample = latency;
+    if (!has_samples_) {
+        srtt_ = sample;
+        min_srtt_ = sample;
+        has_samples_ = true;
+    } else {
+        srtt_ = (1 - ALPHA) * srtt_ + ALPHA * sample;
+        min_srtt_ = std::min(min_srtt_, srtt_);
+    }
+
+    if (srtt_ > LATENCY_SLACK * min_srtt_) {
+        batch_size_ = std::max(batch_size_ / 2, MIN_BATCH);
+    } else if (pool_depth > batch_size_) {
+        batch_size_ = std::min(batch_size_ * 2, MAX_BATCH);
+    }
+}
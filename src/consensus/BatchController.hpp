@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+enum class BatchPolicy {
+    Fixed,    // batch_size of SimulationData in every block
+    Adaptive, // batch size follows the depth of the pool and the latency of blocks
+};
+
+inline const char* to_string(BatchPolicy policy) {
+    switch (policy) {
+        case BatchPolicy::Fixed: return "Fixed";
+        default:                 return "Adaptive";
+    }
+}
+
+/* size of the proposal of the node in the next block.
+   Adaptive policy watches the latency of blocks: while the smoothed latency stays
+   within LATENCY_SLACK of the lowest smoothed latency, the batch doubles if the pool has more
+   than one batch of transactions. When the latency exceeds it, the batch is halved.
+   In both policies the batch never exceeds the depth of the pool, so at light load
+   the node proposes what it has and doesn't wait for a full batch */
+class BatchController {
+public:
+    BatchController(BatchPolicy policy = BatchPolicy::Fixed, size_t batch_size = 1);
+
+    size_t get(size_t pool_depth) const;
+    // latency of the block since its start at the node in microseconds, depth of the pool after the block
+    void add_sample(uint64_t latency, size_t pool_depth);
+
+    BatchPolicy get_policy() const {
+        return policy_;
+    }
+
+private:
+    static const size_t MIN_BATCH = 1;
+    static const size_t MAX_BATCH = 1000;
+
+    BatchPolicy policy_;
+    size_t batch_size_;
+    bool has_samples_{false};
+    double srtt_{0};        // smoothed latency
+    double min_srtt_{0};    // lowest smoothed latency, latency of blocks with small batches
+};
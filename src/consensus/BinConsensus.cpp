@@ -1,423 +1,595 @@
 #include "BinConsensus.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <glog/logging.h>
 
 
-BinConsensus::BinConsensus(uint32_t nodes_cnt, INetManager& net, json msg_base, bool is_psync)
-    : nodes_cnt_(nodes_cnt), net_(net), msg_base_(msg_base), BV_(nodes_cnt, net), is_psync_(is_psync) {
-    state_ = Uninvoked;
+BinConsensusBatch::Round::Round(uint32_t instances_cnt, uint32_t nodes_cnt)
+    : bin_values(instances_cnt, None),
+      coord(instances_cnt, None),
+      timer_expired(instances_cnt, false),
+      start_time(instances_cnt, NOT_STARTED),
+      values(4 * instances_cnt, 0),
+      AUX_from(instances_cnt, nodes_cnt),
+      BV_from{NodeSetArray(instances_cnt, nodes_cnt), NodeSetArray(instances_cnt, nodes_cnt)},
+      BV_states{std::vector<uint8_t>(instances_cnt, BvInit), std::vector<uint8_t>(instances_cnt, BvInit)} {
 }
 
 
-void BinConsensus::bin_propose(uint32_t value) {
-    if (state_ != Uninvoked) {
+BinConsensusBatch::BinConsensusBatch(uint32_t nodes_cnt, uint32_t instances_cnt, INetManager& net,
+                                     CoordTimeout& timeout, const ICoin& coin, Message msg_base,
+                                     BinConsensusOptions options)
+    : nodes_cnt_(nodes_cnt),
+      instances_cnt_(instances_cnt),
+      net_(net),
+      timeout_(timeout),
+      coin_(coin),
+      msg_base_(std::move(msg_base)),
+      is_psync_(options.is_psync),
+      coalesce_(options.coalesce),
+      decide_msgs_(options.decide_msgs),
+      DECIDE_sent_(decide_msgs_ ? instances_cnt : 0, false),
+      DECIDE_from_{NodeSetArray(decide_msgs_ ? instances_cnt : 0, nodes_cnt),
+                   NodeSetArray(decide_msgs_ ? instances_cnt : 0, nodes_cnt)},
+      states_(instances_cnt, Uninvoked),
+      round_(instances_cnt, 0),
+      est_(instances_cnt, 0),
+      decided_(instances_cnt, false),
+      metrics_(instances_cnt) {
+}
+
+
+void BinConsensusBatch::set_round_histogram(LatencyHistogram* histogram) {
+    round_histogram_ = histogram;
+}
+
+void BinConsensusBatch::bin_propose(uint32_t id, uint32_t value) {
+    assert(id < instances_cnt_);
+    if (states_[id] != Uninvoked) {
         return;
     }
 
-    state_ = Init;
-    round_ = 0;
-    est_ = value;
-    if (rounds_.empty()) {
-        rounds_.emplace_back();
-    }
+    states_[id] = Init;
+    round_[id] = 0;
+    est_[id] = value;
+    get_round(0);
 
-    phase_1();
+    phase_1(id);
 }
 
 
-bool BinConsensus::process_msg(Message msg) {
-    if (state_ == Consensus) {
+bool BinConsensusBatch::process_msg(Message msg) {
+    uint32_t id = msg.bin_con_id - msg_base_.bin_con_id;
+    if (msg.bin_con_id < msg_base_.bin_con_id || id >= instances_cnt_) {
+        return false;
+    }
+
+    if (states_[id] == Consensus) {
         return true;
     }
 
-    if (msg.type == "BV") {
-        process_bv_broadcast(msg);
-    } else if (msg.type == "BinConsensus_AUX") {
-        process_AUX(msg);
-    } else if (msg.type == "BinConsensus_COORD" && is_psync_) {
-        process_COORD(msg);
+    switch (msg.type) {
+        case MessageType::BV:
+            process_bv_broadcast(id, msg);
+            break;
+        case MessageType::AUX:
+            process_AUX(id, msg);
+            break;
+        case MessageType::COORD:
+            if (is_psync_) {
+                process_COORD(id, msg);
+            }
+            break;
+        case MessageType::DECIDE:
+            if (decide_msgs_) {
+                process_DECIDE(id, msg);
+            }
+            break;
+        default:
+            break;
     }
 
-    continue_if_ready();
+    continue_if_ready(id);
 
-    if (state_ == Consensus) {
-        DVLOG(5) << net_.get_id() << " " << msg_base_ << " CONSENSUS round: " 
-                 << res_metrics_.rounds_number << " decision: " << get_decision() << std::endl;
+    if (states_[id] == Consensus) {
+        DVLOG(5) << net_.get_id() << " " << make_msg(MessageType::Undefined, id) << " CONSENSUS round: "
+                 << metrics_[id].rounds_number << " decision: " << get_decision(id) << std::endl;
     }
 
-    return state_ == Consensus;
+    return states_[id] == Consensus;
 }
 
-bool BinConsensus::reached_consensus() {
-    return state_ == Consensus;
+bool BinConsensusBatch::reached_consensus(uint32_t id) const {
+    return states_[id] == Consensus;
 }
 
-bool BinConsensus::get_decision() {
-    assert(decided_);
-    return res_metrics_.decision;
+bool BinConsensusBatch::is_decided(uint32_t id) const {
+    return decided_[id];
 }
 
+bool BinConsensusBatch::get_decision(uint32_t id) const {
+    assert(decided_[id]);
+    return metrics_[id].decision;
+}
+
+BinConsensusMetrics BinConsensusBatch::get_metrics(uint32_t id) const {
+    assert(states_[id] == Consensus);
+    return metrics_[id];
+}
 
-void BinConsensus::inc_round(uint32_t new_est) {
-    ++round_;
-    est_ = new_est;
-    if (rounds_.size() <= round_) {
-        rounds_.emplace_back();
+size_t BinConsensusBatch::get_rounds_number() const {
+    size_t rounds_number = 0;
+    for (const auto& metrics : metrics_) {
+        rounds_number = std::max(rounds_number, metrics.rounds_number);
     }
+    return rounds_number;
 }
 
 
-void BinConsensus::add_binvalue(uint32_t round, uint32_t value) {
-    if (value > 3) {
+BinConsensusBatch::Round& BinConsensusBatch::get_round(uint32_t round) {
+    while (rounds_.size() <= round) {
+        rounds_.emplace_back(instances_cnt_, nodes_cnt_);
+    }
+    return rounds_[round];
+}
+
+Message BinConsensusBatch::make_msg(MessageType type, uint32_t id) const {
+    Message msg(type, msg_base_);
+    msg.bin_con_id = msg_base_.bin_con_id + id;
+    return msg;
+}
+
+void BinConsensusBatch::broadcast(const Message& msg) {
+    if (!coalesce_) {
+        net_.broadcast(msg);
         return;
     }
+    pending_.push_back(BinUpdate{msg.type, msg.bin_con_id, msg.round, msg.value});
+}
 
-    if (rounds_.size() <= round) {
-        rounds_.resize(round + 1);
+void BinConsensusBatch::schedule_flush() {
+    if (pending_.empty() || is_flush_scheduled_) {
+        return;
     }
 
-    BinValues& bin_values = rounds_[round].bin_values;
+    is_flush_scheduled_ = true;
+    net_.set_timer(FLUSH_DELAY, [this, alive = std::weak_ptr<bool>(alive_)] {
+        if (alive.expired()) {
+            return;
+        }
+        this->is_flush_scheduled_ = false;
+        this->flush();
+    });
+}
 
-    if (bin_values == Both || bin_values == static_cast<BinValues>(value + 1)) {
+void BinConsensusBatch::flush() {
+    if (pending_.empty()) {
         return;
     }
 
-    bin_values = static_cast<BinValues>(bin_values + value + 1);
+    Message batch(MessageType::BIN_BATCH, msg_base_);
+    batch.data = std::make_shared<const std::vector<BinUpdate>>(std::move(pending_));
+    pending_ = std::vector<BinUpdate>();
+    net_.broadcast(batch);
 }
 
 
-void BinConsensus::phase_1() {
-    json EST_data(msg_base_);
-    EST_data["round"] = round_;
-    EST_data["value"] = est_;
+void BinConsensusBatch::inc_round(uint32_t id, uint32_t new_est) {
+    ++round_[id];
+    est_[id] = new_est;
+    get_round(round_[id]);
+}
 
-    DVLOG(5) << net_.get_id() << " " << msg_base_ << " phase_1 BvBroadcast EST: " << EST_data;
 
-    BV_.broadcast(EST_data); // BV-broadcast est_;
-    state_ = BvBroadcast;
-    if (decided_) {
-        add_binvalue(round_, est_);
-        rounds_[round_].timer_expired = true;
+void BinConsensusBatch::add_binvalue(uint32_t id, uint32_t round, uint32_t value) {
+    if (value > 3) {
+        return;
     }
 
-    if (is_psync_ && !decided_) {
-        net_.set_timer(10000 + 500 * (round_ + 1), [this]{
-            this->rounds_[this->round_].timer_expired = true;
-            this->continue_if_ready();
-        });
+    uint8_t& bin_values = get_round(round).bin_values[id];
+
+    if (bin_values == Both || bin_values == value + 1) {
+        return;
     }
 
-    continue_if_ready();
+    bin_values = bin_values + value + 1;
 }
 
 
-void BinConsensus::process_bv_broadcast(Message msg) {
-    DVLOG(6) << net_.get_id() << " " << msg_base_ << " got msg: " << msg;
+void BinConsensusBatch::phase_1(uint32_t id) {
+    Message EST_data = make_msg(MessageType::BV, id);
+    EST_data.round = round_[id];
+    EST_data.value = est_[id];
 
-    if (!msg.data.contains("round") || msg.data["round"] < round_) {
-        return;
+    DVLOG(5) << net_.get_id() << " " << EST_data << " phase_1 BvBroadcast EST: " << EST_data;
+
+    BV_broadcast(id, EST_data); // BV-broadcast est_;
+    states_[id] = BvBroadcast;
+    rounds_[round_[id]].start_time[id] = net_.now();
+    if (decided_[id]) {
+        add_binvalue(id, round_[id], est_[id]);
+        rounds_[round_[id]].timer_expired[id] = true;
+    }
+
+    if (is_psync_ && !decided_[id]) {
+        net_.set_timer(timeout_.get(round_[id]), [this, id, alive = std::weak_ptr<bool>(alive_)] {
+            if (alive.expired() || this->states_[id] == Consensus) {
+                return;
+            }
+
+            Round& round = this->rounds_[this->round_[id]];
+            ++this->metrics_[id].timers_cnt;
+            if (round.coord[id] == None) {
+                ++this->metrics_[id].timeouts_cnt;
+            }
+            round.timer_expired[id] = true;
+            this->continue_if_ready(id);
+            this->schedule_flush();
+        });
     }
 
-    auto BV_res = BV_.process_msg(std::move(msg));
-    if (!BV_res.has_value()) {
+    continue_if_ready(id);
+}
+
+
+void BinConsensusBatch::BV_broadcast(uint32_t id, const Message& msg) {
+    uint32_t value = msg.value;
+    if ((value & 1) != value) {
         return;
     }
 
-    // BV-delivery
-    // add to bin_values_[round_] upon BV-delivery
-    json delivered_data = BV_res.value();
-    DVLOG(6) << net_.get_id() << " " << msg_base_ << " bv-delivered: " << delivered_data;
-    if (!delivered_data.contains("round") || delivered_data["round"] < round_
-        || !delivered_data.contains("value")) {
+    uint8_t& state = get_round(msg.round).BV_states[value][id];
+    if (state >= BvSent) {
         return;
     }
 
-    add_binvalue(delivered_data["round"], delivered_data["value"]);
+    broadcast(msg);
+    state = BvSent;
+}
+
+bool BinConsensusBatch::BV_deliver(uint32_t id, const Message& msg) {
+    DVLOG(6) << net_.get_id() << " bv-process" << msg << std::endl;
+    if (static_cast<uint32_t>(msg.from) >= nodes_cnt_) {
+        return false;
+    }
+
+    uint32_t value = msg.value;
+    if ((value & 1) != value) {
+        return false;
+    }
+
+    Round& round = get_round(msg.round);
+    uint8_t& state = round.BV_states[value][id];
+    if (state == BvDelivered) {
+        return false;
+    }
+
+    round.BV_from[value].insert(id, msg.from);
+    uint32_t received = round.BV_from[value].size(id);
+    DVLOG(6) << net_.get_id() << " " << msg << " received_from: " << received << std::endl;
+    if (received >= (nodes_cnt_ - 1) / 3 + 1 && state < BvSent) {
+        broadcast(msg);
+        state = BvSent;
+    }
+
+    if (received >= (nodes_cnt_ - 1) / 3 * 2 + 1) {
+        state = BvDelivered;
+        return true;
+    }
+
+    return false;
 }
 
-void BinConsensus::process_COORD(Message msg) {
-    DVLOG(6) << net_.get_id() << " " << msg_base_ << " got msg: " << msg;
 
-    if (msg.type != "BinConsensus_COORD" || !is_psync_) {
+void BinConsensusBatch::process_bv_broadcast(uint32_t id, const Message& msg) {
+    DVLOG(6) << net_.get_id() << " got msg: " << msg;
+
+    if (msg.round < round_[id]) {
         return;
     }
 
-    if (!msg.data.contains("round") || msg.data["round"] < round_
-        || !msg.data.contains("binvalues")) {
+    if (!BV_deliver(id, msg)) {
         return;
     }
 
-    uint32_t round = msg.data["round"];
-    if ((uint32_t)msg.from != round % nodes_cnt_) {
-        // not real coordinator
+    // BV-delivery
+    // add to bin_values of the round upon BV-delivery
+    DVLOG(6) << net_.get_id() << " bv-delivered: " << msg;
+    Round& round = rounds_[msg.round];
+    if (msg.round == round_[id] && round.bin_values[id] == None && round.start_time[id] != NOT_STARTED) {
+        // first value of the current round, COORD is expected after it
+        timeout_.add_sample(net_.now() - round.start_time[id]);
+    }
+    add_binvalue(id, msg.round, msg.value);
+}
+
+void BinConsensusBatch::process_COORD(uint32_t id, const Message& msg) {
+    DVLOG(6) << net_.get_id() << " got msg: " << msg;
+
+    if (msg.round < round_[id]) {
         return;
     }
 
-    if (rounds_.size() <= round) {
-        rounds_.resize(round + 1);
+    uint32_t round = msg.round;
+    if ((uint32_t)msg.from != round % nodes_cnt_) {
+        // not real coordinator
+        return;
     }
 
-    uint32_t bin_values = msg.data["binvalues"];
-    if (rounds_[round].coord == None && (bin_values == Zero || bin_values == One)) {
-        rounds_[round].coord = static_cast<BinValues>(bin_values);
+    uint32_t bin_values = msg.value;
+    uint8_t& coord = get_round(round).coord[id];
+    if (coord == None && (bin_values == Zero || bin_values == One)) {
+        coord = bin_values;
     }
 }
 
-void BinConsensus::phase_coord() {
-    if (net_.get_id() != round_ % nodes_cnt_) {
+void BinConsensusBatch::phase_coord(uint32_t id) {
+    if (net_.get_id() != round_[id] % nodes_cnt_) {
         return;
     }
 
-    if (rounds_[round_].coord != None) {
+    Round& round = rounds_[round_[id]];
+    if (round.coord[id] != None) {
         // already broadcasted coordinator value
         return;
     }
 
-    rounds_[round_].coord = rounds_[round_].bin_values;
+    round.coord[id] = round.bin_values[id];
 
-    json COORD_data(msg_base_);
-    COORD_data["round"] = round_;
-    COORD_data["binvalues"] = rounds_[round_].coord;
+    Message COORD_data = make_msg(MessageType::COORD, id);
+    COORD_data.round = round_[id];
+    COORD_data.value = round.coord[id];
 
-    DVLOG(5) << net_.get_id() << " " << msg_base_ << " phase_coord broadcast COORD: " << COORD_data;
+    DVLOG(5) << net_.get_id() << " phase_coord broadcast COORD: " << COORD_data;
 
-    net_.broadcast(Message("BinConsensus_COORD", COORD_data));
+    broadcast(COORD_data);
 }
 
-void BinConsensus::phase_2() {
-    // broadcast AUX[ri](bin_values_[round_]);
-    json AUX_data(msg_base_);
-    AUX_data["round"] = round_;
-    AUX_data["binvalues"] = rounds_[round_].bin_values;
+void BinConsensusBatch::phase_2(uint32_t id) {
+    Round& round = rounds_[round_[id]];
+
+    // broadcast AUX[ri](bin_values[round_]);
+    Message AUX_data = make_msg(MessageType::AUX, id);
+    AUX_data.round = round_[id];
+    AUX_data.value = round.bin_values[id];
 
-    if (is_psync_ && !decided_) { 
-        uint32_t coord = rounds_[round_].coord;
-        if (coord != None && ((coord & rounds_[round_].bin_values) == coord)) {
-            AUX_data["binvalues"] = rounds_[round_].coord;
+    if (is_psync_ && !decided_[id]) {
+        uint32_t coord = round.coord[id];
+        if (coord != None && ((coord & round.bin_values[id]) == coord)) {
+            AUX_data.value = coord;
         }
     }
 
-    DVLOG(5) << net_.get_id() << " " << msg_base_ << " phase_2 broadcast AUX: " << AUX_data;
+    DVLOG(5) << net_.get_id() << " phase_2 broadcast AUX: " << AUX_data;
 
-    net_.broadcast(Message("BinConsensus_AUX", AUX_data));
-    state_ = Broadcast;
+    broadcast(AUX_data);
+    states_[id] = Broadcast;
 
-    if (decided_) {
-        phase_3(static_cast<BinValues>(rounds_[round_].bin_values));
+    if (decided_[id]) {
+        phase_3(id, static_cast<BinValues>(round.bin_values[id]));
     } else {
-        continue_if_ready();
+        continue_if_ready(id);
     }
 }
 
 
-void BinConsensus::process_AUX(Message msg) {
-    DVLOG(6) << net_.get_id() << " " << msg_base_ <<" got msg: " << msg;
+void BinConsensusBatch::process_AUX(uint32_t id, const Message& msg) {
+    DVLOG(6) << net_.get_id() << " got msg: " << msg;
 
-    if (msg.type != "BinConsensus_AUX") {
+    if (static_cast<uint32_t>(msg.from) >= nodes_cnt_) {
         return;
     }
 
-    if (!msg.data.contains("round") || msg.data["round"] < round_
-        || !msg.data.contains("binvalues")) {
+    if (msg.round < round_[id]) {
         return;
     }
 
-    uint32_t round = msg.data["round"];
-    if (rounds_.size() <= round) {
-        rounds_.resize(round + 1);
+    uint32_t bin_values = msg.value;
+    if (bin_values > BinValues::Both || bin_values == None) {
+        return;
     }
 
-    uint32_t bin_values = msg.data["binvalues"];
-    if (bin_values > BinValues::Both || bin_values == None) {
+    Round& round = get_round(msg.round);
+    if (round.AUX_from.insert(id, msg.from)) {
+        ++round.values[4 * id + bin_values];
+    }
+}
+
+
+void BinConsensusBatch::process_DECIDE(uint32_t id, const Message& msg) {
+    DVLOG(6) << net_.get_id() << " got msg: " << msg;
+
+    uint32_t value = msg.value;
+    if (static_cast<uint32_t>(msg.from) >= nodes_cnt_ || (value & 1) != value) {
         return;
     }
 
-    if (!rounds_[round].received_AUXes.contains(msg.from)) {
-        rounds_[round].received_AUXes.insert(msg.from);
-        ++rounds_[round].values[bin_values];
+    if (!DECIDE_from_[value].insert(id, msg.from)) {
+        return;
+    }
+
+    // f + 1 DECIDEs contain DECIDE of a fair node
+    uint32_t received = DECIDE_from_[value].size(id);
+    if (received >= (nodes_cnt_ - 1) / 3 + 1) {
+        broadcast_DECIDE(id, value);
+    }
+
+    // f + 1 fair nodes decided, so every fair node gets f + 1 DECIDEs and echoes them
+    if (received >= nodes_cnt_ - (nodes_cnt_ - 1) / 3) {
+        if (!decided_[id]) {
+            set_decision(id, value);
+        }
+        set_consensus(id);
+    }
+}
+
+void BinConsensusBatch::broadcast_DECIDE(uint32_t id, uint32_t value) {
+    if (DECIDE_sent_[id]) {
+        return;
     }
+
+    Message DECIDE_data = make_msg(MessageType::DECIDE, id);
+    DECIDE_data.value = value;
+    broadcast(DECIDE_data);
+    DECIDE_sent_[id] = true;
 }
 
 
-void BinConsensus::phase_3(BinValues values) {
-    int b = (round_ + 1) % 2;
+void BinConsensusBatch::phase_3(uint32_t id, BinValues values) {
+    uint32_t finished_round = round_[id];
+    uint32_t b = coin_.get(msg_base_.block_id, msg_base_.bin_con_id + id, finished_round);
+
+    uint64_t round_time = net_.now() - rounds_[round_[id]].start_time[id];
+    ++metrics_[id].rounds_cnt;
+    metrics_[id].rounds_time += round_time;
+    if (round_histogram_) {
+        round_histogram_->record(round_time);
+    }
 
-    DVLOG(5) << net_.get_id() << " " << msg_base_ << " phase_3" << std::endl;
+    DVLOG(5) << net_.get_id() << " " << make_msg(MessageType::Undefined, id) << " phase_3" << std::endl;
 
     if (values == Zero || values == One) {
-        inc_round(values / 2);
-        if (!decided_ && values / 2 == b) {
-            set_decision();
+        inc_round(id, values / 2);
+        if (!decided_[id] && values / 2 == b) {
+            set_decision(id, b);
         }
     } else {
-        inc_round(b);
+        inc_round(id, b);
     }
 
-    DVLOG(5) << net_.get_id() << " " << msg_base_ << " finished round: " << round_ - 1
-             << " est: " << est_ << " bin_values: " << rounds_[round_ - 1].bin_values
+    DVLOG(5) << net_.get_id() << " " << make_msg(MessageType::Undefined, id)
+             << " finished round: " << round_[id] - 1 << " est: " << uint32_t(est_[id])
+             << " bin_values: " << uint32_t(rounds_[round_[id] - 1].bin_values[id])
              << " values: " << values;
 
-    if (decided_ && round_ >= res_metrics_.rounds_number + 2) {
-        state_ = Consensus;
+    /* decided instance helps others to decide up to the next round with coin equal to the decision,
+       all fair nodes have the decision as est since the round of decision */
+    if (decided_[id] && finished_round >= metrics_[id].rounds_number && b == metrics_[id].decision) {
+        set_consensus(id);
         return;
     }
 
-    phase_1();
+    if (decide_msgs_ && decided_[id]) {
+        states_[id] = Paused;
+        continue_if_ready(id);
+        return;
+    }
+
+    phase_1(id);
 }
 
 
-void BinConsensus::continue_if_ready() {
-    auto& round = rounds_[round_];
-    if (state_ == BvBroadcast && round.bin_values != None) {
+void BinConsensusBatch::continue_if_ready(uint32_t id) {
+    if (states_[id] == Consensus) {
+        return;
+    }
+
+    Round& round = get_round(round_[id]);
+    if (states_[id] == BvBroadcast && round.bin_values[id] != None) {
         if (!is_psync_) {
-            phase_2();
+            phase_2(id);
             return;
         }
 
-        phase_coord();
-        if (round.timer_expired) {
-            phase_2();
+        phase_coord(id);
+        if (round.timer_expired[id]) {
+            phase_2(id);
         }
-    } else if (state_ == Broadcast) {
-        if (round.received_AUXes.size() < nodes_cnt_ - (nodes_cnt_ - 1) / 3) {
+    } else if (states_[id] == Broadcast) {
+        uint32_t quorum = nodes_cnt_ - (nodes_cnt_ - 1) / 3;
+        if (round.AUX_from.size(id) < quorum) {
             return;
         }
 
-        if (round.bin_values != Both) {
-            if (round.values[round.bin_values] < nodes_cnt_ - (nodes_cnt_ - 1) / 3) {
+        const uint32_t* counts = &round.values[4 * id];
+        uint8_t bin_values = round.bin_values[id];
+        if (bin_values != Both) {
+            if (counts[bin_values] < quorum) {
                 return;
             }
 
-            phase_3(static_cast<BinValues>(round.bin_values));
+            phase_3(id, static_cast<BinValues>(bin_values));
             return;
         }
 
         uint32_t values = 0;
         for (uint32_t i = BinValues::Zero; i <= BinValues::Both; ++i) {
-            if (round.values[i] > 0) {
+            if (counts[i] > 0) {
                 values |= i;
             }
         }
-        phase_3(static_cast<BinValues>(values));
-    }
-}
-
-void BinConsensus::set_decision() {
-    // time to-do
-    assert(!decided_);
-
-    decided_ = true;
-    res_metrics_.decision = est_;
-    res_metrics_.rounds_number = round_;
-
-    DVLOG(5) << net_.get_id() << " " << msg_base_ << " DECIDED round: " 
-             << res_metrics_.rounds_number << " decision: " << get_decision() << std::endl;
-}
-
-BinConsensusMetrics BinConsensus::get_metrics() {
-    assert(state_ == Consensus);
-    return res_metrics_;
-}
-
-void BinConsensus::execute_byzantine(Role role) {
-    state_ = Consensus;
-    if (role == FailStop) {
-        return;
-    }
-
-    json EST_data(msg_base_), AUX_data(msg_base_), COORD_data(msg_base_);
-
-    for (uint32_t round = 0; round < 10; ++round) {
-        EST_data["round"] = round;
-        for (uint32_t value = 0; value < (role == TxRejector ? 1 : 2); ++value) {
-            EST_data["value"] = value;
-            BV_.broadcast(EST_data);
-        }
-
-        if (is_psync_ && net_.get_id() == round % nodes_cnt_) {
-            COORD_data["round"] = round;
-            for (uint32_t value = 0; value < (role == TxRejector ? 1 : 2); ++value) {
-                COORD_data["binvalues"] = value;
-                net_.broadcast(Message("BinConsensus_COORD", COORD_data));
-            }
+        phase_3(id, static_cast<BinValues>(values));
+    } else if (states_[id] == Paused) {
+        // f + 1 nodes in the round include a fair one, which didn't get enough DECIDEs
+        if (round.BV_from[est_[id]].size(id) >= (nodes_cnt_ - 1) / 3 + 1) {
+            phase_1(id);
         }
-
-        AUX_data["round"] = round;
-        AUX_data["binvalues"] = (role == TxRejector ? Zero : Both);
-        net_.broadcast(Message("BinConsensus_AUX", AUX_data));
     }
 }
 
+void BinConsensusBatch::set_decision(uint32_t id, uint32_t value) {
+    assert(!decided_[id]);
 
-BVbroadcast::BVbroadcast(int nodes_cnt, INetManager& net) : nodes_cnt_(nodes_cnt), net_(net) {
-}
+    decided_[id] = true;
+    metrics_[id].decision = value;
+    metrics_[id].decision_time = net_.now();
+    metrics_[id].rounds_number = round_[id];
 
-void BVbroadcast::broadcast(const json& data) {
-    if (!data.contains("round") || !data.contains("value")) {
-        return;
-    }
+    DVLOG(5) << net_.get_id() << " " << make_msg(MessageType::Undefined, id) << " DECIDED round: "
+             << metrics_[id].rounds_number << " decision: " << get_decision(id) << std::endl;
 
-    uint32_t round = data["round"];
-    uint32_t value = data["value"];
-
-    Instance& instance = get_instance(round);
-    if ((value & 1) != value || instance.states_[value] >= Broadcast) {
-        return;
+    if (decide_msgs_) {
+        broadcast_DECIDE(id, value);
     }
-
-    net_.broadcast(Message("BV", data));
-    instance.states_[value] = Broadcast;
 }
 
-std::optional<json> BVbroadcast::process_msg(Message msg) {
-    DVLOG(6) << net_.get_id() << " bv-process" << msg << std::endl;
-    if (!check_type(msg)) {
-        return std::nullopt;
+void BinConsensusBatch::set_consensus(uint32_t id) {
+    states_[id] = Consensus;
+    ++consensus_cnt_;
+    if (decided_[id]) {
+        metrics_[id].rounds_after_decision = round_[id] - metrics_[id].rounds_number;
     }
 
-    uint32_t value = msg.data["value"];
-    DVLOG(6) << net_.get_id() << " " << msg << " value: " << value<< std::endl;
-    if ((value & 1) != value) {
-        return std::nullopt;
+    // messages are not processed after consensus of all instances, so state of rounds isn't needed
+    if (consensus_cnt_ == instances_cnt_) {
+        rounds_ = std::deque<Round>();
     }
+}
 
-    uint32_t round = msg.data["round"];
-    DVLOG(6) << net_.get_id() << " " << msg << " round: " << round << std::endl;
-    Instance& instance = get_instance(round);
-    if (instance.states_[value] == Delivered) {
-        return std::nullopt;
-    }
+void BinConsensusBatch::execute_byzantine(Role role) {
+    for (uint32_t id = 0; id < instances_cnt_; ++id) {
+        if (states_[id] != Consensus) {
+            set_consensus(id);
+        }
+        if (role == FailStop) {
+            continue;
+        }
 
-    instance.received_from_[value].insert(msg.from);
-    json a = {{"received_from", instance.received_from_[value]}};
-    DVLOG(6) << net_.get_id() << " " << msg << " " << a << std::endl; 
-    if (instance.received_from_[value].size() >= (nodes_cnt_ - 1) / 3 + 1
-        && instance.states_[value] < Broadcast) {
-            net_.broadcast(msg);
-            instance.states_[value] = Broadcast;
-    }
+        Message EST_data = make_msg(MessageType::BV, id);
+        Message AUX_data = make_msg(MessageType::AUX, id);
+        Message COORD_data = make_msg(MessageType::COORD, id);
 
-    if (instance.received_from_[value].size() >= (nodes_cnt_ - 1) / 3 * 2 + 1) {
-        instance.states_[value] = Delivered;
-        return msg.data;
-    }
+        for (uint32_t round = 0; round < 10; ++round) {
+            EST_data.round = round;
+            for (uint32_t value = 0; value < (role == TxRejector ? 1 : 2); ++value) {
+                EST_data.value = value;
+                BV_broadcast(id, EST_data);
+            }
 
-    return std::nullopt;
-}
+            if (is_psync_ && net_.get_id() == round % nodes_cnt_) {
+                COORD_data.round = round;
+                for (uint32_t value = 0; value < (role == TxRejector ? 1 : 2); ++value) {
+                    COORD_data.value = value;
+                    broadcast(COORD_data);
+                }
+            }
 
-bool BVbroadcast::check_type(const Message& msg) const {
-    if (msg.type != "BV") {
-        return false;
+            AUX_data.round = round;
+            AUX_data.value = (role == TxRejector ? Zero : Both);
+            broadcast(AUX_data);
+        }
     }
-
-    return msg.data.contains("round") && msg.data.contains("value");
+    rounds_ = std::deque<Round>();
+    flush();
 }
-
-BVbroadcast::Instance& BVbroadcast::get_instance(uint32_t r) {
-    if (instances_.size() <= r) {
-        instances_.resize(r + 1);
-    }
-
-    return instances_[r];
-}
\ No newline at end of file
@@ -1,115 +1,204 @@
 #pragma once
 
-#include <vector>
-#include <unordered_set>
 #include <cassert>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
 
 #include "../node/role.hpp"
 #include "../core/message.hpp"
+#include "../core/node_set.hpp"
 #include "../network/netmanager.hpp"
 #include "../consensus/ReliableBroadcast.hpp"
 #include "../consensus/metrics.hpp"
+#include "../consensus/CoordTimeout.hpp"
+#include "../consensus/Coin.hpp"
 
-class BVbroadcast {
-    enum State {
-        Init = 0,
-        Broadcast = 1,
-        Delivered = 2,
-    };
-
-    struct Instance {
-        std::unordered_set<uint32_t> received_from_[2];
-        State states_[2] = {Init, Init};
-    };
-
-public:
-    BVbroadcast(int nodes_cnt, INetManager& net);
-    void broadcast(const json& data);
-    std::optional<json> process_msg(Message msg);
-    // bool is_delivered(const json& data);
-
-private:
-    bool check_type(const Message& msg) const;
-    BVbroadcast::Instance& get_instance(uint32_t r);
-
-private:
-    uint32_t nodes_cnt_;
-    INetManager& net_;
-    std::vector<Instance> instances_;
+struct BinConsensusOptions {
+    bool is_psync{true};        // rounds have coordinators, whose values are awaited until the timeout
+    bool coalesce{false};       // BV / AUX / COORD of all instances are sent in BIN_BATCH messages
+    bool decide_msgs{false};    // decided instances broadcast DECIDE
 };
 
-
-
-class BinConsensus {
+/* instances_cnt binary consensuses with bin_con_ids from msg_base.bin_con_id on (all consensuses of a block).
+   State of the instances is stored in contiguous arrays indexed by instance:
+   round, estimation and decision of every instance, and for every round
+   bin_values, coordinator values, counters of AUX values and senders of BV and AUX.
+   If coalesce is true, BV / AUX / COORD of all instances are buffered
+   and sent as one BIN_BATCH message once per FLUSH_DELAY.
+   If decide_msgs is true, decided instance broadcasts DECIDE. f + 1 equal DECIDEs are echoed,
+   n - f equal DECIDEs stop the instance, so decided nodes don't run rounds after decision,
+   unless f + 1 nodes are still in the next round */
+class BinConsensusBatch {
 private:
-    enum State {
+    enum State : uint8_t {
         Uninvoked,
         Init,
         BvBroadcast,
         Broadcast,
+        Paused,     // decided, waits for DECIDE of others or for f + 1 nodes in the next round
         Consensus,
     };
 
-    enum BinValues {
+    enum BinValues : uint8_t {
         None = 0,
         Zero = 1,
         One = 2,
         Both = 3,
     };
 
-    struct RoundData {
-        BinValues bin_values{None};
-        BinValues coord{None};      // used only if is_psync_ == true
-        bool timer_expired{false};  // used only if is_psync_ == true
-        uint32_t values[4] = {0, 0, 0, 0};
-        std::unordered_set<uint32_t> received_AUXes;
+    // state of BVbroadcast of one value
+    enum BvState : uint8_t {
+        BvInit = 0,
+        BvSent = 1,
+        BvDelivered = 2,
+    };
+
+    // state of all instances in one round
+    struct Round {
+        Round(uint32_t instances_cnt, uint32_t nodes_cnt);
+
+        std::vector<uint8_t> bin_values;    // BinValues
+        std::vector<uint8_t> coord;         // BinValues, used only if is_psync_ == true
+        std::vector<uint8_t> timer_expired; // used only if is_psync_ == true
+        std::vector<uint64_t> start_time;   // of the round, NOT_STARTED if the instance isn't in it yet
+        std::vector<uint32_t> values;       // 4 counters of AUX values per instance
+        NodeSetArray AUX_from;
+        NodeSetArray BV_from[2];            // senders of BV with value 0 and 1
+        std::vector<uint8_t> BV_states[2];  // BvState
     };
 
 public:
-    BinConsensus(uint32_t nodes_cnt, INetManager& net, json msg_base = {}, bool is_psync = true);
-    void bin_propose(uint32_t value);
+    BinConsensusBatch(uint32_t nodes_cnt, uint32_t instances_cnt, INetManager& net,
+                      CoordTimeout& timeout, const ICoin& coin, Message msg_base = Message(),
+                      BinConsensusOptions options = {});
+    void bin_propose(uint32_t id, uint32_t value);
+    // returns true if the instance of msg reached consensus
     bool process_msg(Message msg);
-    bool reached_consensus();
-    bool get_decision();
-    BinConsensusMetrics get_metrics();
+    bool reached_consensus(uint32_t id) const;
+    // the instance decided in its rounds or adopted the decision from DECIDEs
+    bool is_decided(uint32_t id) const;
+    bool get_decision(uint32_t id) const;
+    BinConsensusMetrics get_metrics(uint32_t id) const;
+    // max rounds_number of all instances
+    size_t get_rounds_number() const;
+    // durations of finished rounds of the instances are recorded to histogram, if it isn't nullptr
+    void set_round_histogram(LatencyHistogram* histogram);
 
     void execute_byzantine(Role role);
+    // broadcasts buffered messages of the instances in FLUSH_DELAY, if coalesce is true
+    void schedule_flush();
+    // broadcasts buffered messages of the instances now
+    void flush();
 
 private:
-    void inc_round(uint32_t new_est);
-    void add_binvalue(uint32_t round, uint32_t value);
+    Round& get_round(uint32_t round);
+    Message make_msg(MessageType type, uint32_t id) const;
+    void broadcast(const Message& msg);
+
+    void inc_round(uint32_t id, uint32_t new_est);
+    void add_binvalue(uint32_t id, uint32_t round, uint32_t value);
+
+    void BV_broadcast(uint32_t id, const Message& msg);
+    // returns true if msg is BV-delivered
+    bool BV_deliver(uint32_t id, const Message& msg);
 
     // process msg from BvBroadcast
-    void process_bv_broadcast(Message msg);
+    void process_bv_broadcast(uint32_t id, const Message& msg);
     // process msg from coordinator
-    void process_COORD(Message msg);
+    void process_COORD(uint32_t id, const Message& msg);
     // process msg from broadcast
-    void process_AUX(Message msg);
-
-    void phase_1();
-    void phase_coord();
-    void phase_2();
-    void phase_3(BinValues values_);
+    void process_AUX(uint32_t id, const Message& msg);
+    // process decision of other node
+    void process_DECIDE(uint32_t id, const Message& msg);
+    void broadcast_DECIDE(uint32_t id, uint32_t value);
+
+    void phase_1(uint32_t id);
+    void phase_coord(uint32_t id);
+    void phase_2(uint32_t id);
+    void phase_3(uint32_t id, BinValues values);
     // function determines, whether algorithm can get to the next phase
-    void continue_if_ready();
+    void continue_if_ready(uint32_t id);
 
-    void set_decision();
+    // records the decision and its time, the only way an instance becomes decided
+    void set_decision(uint32_t id, uint32_t value);
+    void set_consensus(uint32_t id);
 
 private:
-    uint32_t nodes_cnt_; // why don't use net_.nodes_cnt()?
-    INetManager& net_;
-    json msg_base_; // info, how to get to this BinConsensus instance (block_id, bin_con_id)
+    static const uint64_t NOT_STARTED = UINT64_MAX;
 
-    BVbroadcast BV_;
-    BinConsensusMetrics res_metrics_;
-    bool decided_{false};
+    uint32_t nodes_cnt_;
+    uint32_t instances_cnt_;
+    INetManager& net_;
+    CoordTimeout& timeout_; // of the coordinator, shared with other batches of the node
+    const ICoin& coin_;
+    Message msg_base_; // info, how to get to the instances (block_id, first bin_con_id)
 
-    /*  true - using PSYNC Algorithm, that adds weak coordinators 
+    /*  true - using PSYNC Algorithm, that adds weak coordinators
         false - just original BA algorithm, but without common coin, no weak coordinators */
     bool is_psync_{false};
 
-    State state_{Uninvoked};
-    uint32_t round_{0};
-    uint32_t est_;
-    std::vector<RoundData> rounds_;
+    // one tick of TimerChannel, in microseconds
+    static const uint32_t FLUSH_DELAY = 100;
+
+    bool coalesce_{false};
+    std::vector<BinUpdate> pending_; // buffered messages, if coalesce_ == true
+    bool is_flush_scheduled_{false};
+
+    bool decide_msgs_{false};
+    std::vector<uint8_t> DECIDE_sent_;
+    NodeSetArray DECIDE_from_[2];   // senders of DECIDE with value 0 and 1
+
+    std::vector<uint8_t> states_;   // State
+    std::vector<uint32_t> round_;
+    std::vector<uint8_t> est_;
+    std::vector<uint8_t> decided_;
+    std::vector<BinConsensusMetrics> metrics_;
+    LatencyHistogram* round_histogram_{nullptr};
+    uint32_t consensus_cnt_{0};
+
+    // references are kept valid while new rounds are added
+    std::deque<Round> rounds_;
+
+    // timers of the instances are ignored after the batch is destroyed
+    std::shared_ptr<bool> alive_{std::make_shared<bool>(true)};
+};
+
+
+// single binary consensus
+class BinConsensus {
+public:
+    BinConsensus(uint32_t nodes_cnt, INetManager& net, Message msg_base = Message(), bool is_psync = true)
+        : batch_(nodes_cnt, 1, net, timeout_, coin_, std::move(msg_base), {.is_psync = is_psync}) {
+    }
+
+    void bin_propose(uint32_t value) {
+        batch_.bin_propose(0, value);
+    }
+
+    bool process_msg(Message msg) {
+        return batch_.process_msg(std::move(msg));
+    }
+
+    bool reached_consensus() {
+        return batch_.reached_consensus(0);
+    }
+
+    bool get_decision() {
+        return batch_.get_decision(0);
+    }
+
+    BinConsensusMetrics get_metrics() {
+        return batch_.get_metrics(0);
+    }
+
+    void execute_byzantine(Role role) {
+        batch_.execute_byzantine(role);
+    }
+
+private:
+    CoordTimeout timeout_;
+    ParityCoin coin_;
+    BinConsensusBatch batch_;
 };
@@ -0,0 +1,19 @@
+#include "Coin.hpp"
+
+#include "../core/hash.hpp"
+
+uint32_t CommonCoin::get(uint32_t block_id, uint32_t bin_con_id, uint32_t round) const {
+    if (round < FIXED_ROUNDS) {
+        return (round + 1) % 2;
+    }
+
+    uint64_t instance = (static_cast<uint64_t>(block_id) << 32) | bin_con_id;
+    return splitmix64(splitmix64(seed_ ^ splitmix64(instance)) ^ round) & 1;
+}
+
+std::unique_ptr<ICoin> make_coin(CoinType type, uint64_t seed) {
+    if (type == CoinType::Common) {
+        return std::make_unique<CommonCoin>(seed);
+    }
+    return std::make_unique<ParityCoin>();
+}
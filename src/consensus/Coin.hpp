@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+enum class CoinType {
+    Parity, // (round + 1) % 2, known to everyone in advance
+    Common, // pseudo-random from round 2 on, same for all nodes
+};
+
+inline const char* to_string(CoinType type) {
+    switch (type) {
+        case CoinType::Parity: return "Parity";
+        default:               return "Common";
+    }
+}
+
+// coin of phase_3 of binary consensus
+class ICoin {
+public:
+    virtual uint32_t get(uint32_t block_id, uint32_t bin_con_id, uint32_t round) const = 0;
+    virtual ~ICoin() = default;
+};
+
+class ParityCoin : public ICoin {
+public:
+    uint32_t get(uint32_t, uint32_t, uint32_t round) const override {
+        return (round + 1) % 2;
+    }
+};
+
+/* simulation of the threshold common coin: the value of such coin is a function of the shared key
+   and of the instance, so the key is replaced by seed, shared by all nodes,
+   and the value is computed locally without exchanging coin shares.
+   Rounds 0 and 1 use fixed values 1 and 0, so in good case the instance decides as fast as with ParityCoin */
+class CommonCoin : public ICoin {
+public:
+    CommonCoin(uint64_t seed) : seed_(seed) {
+    }
+
+    uint32_t get(uint32_t block_id, uint32_t bin_con_id, uint32_t round) const override;
+
+private:
+    static const uint32_t FIXED_ROUNDS = 2;
+
+    uint64_t seed_;
+};
+
+std::unique_ptr<ICoin> make_coin(CoinType type, uint64_t seed);
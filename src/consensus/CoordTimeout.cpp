@@ -0,0 +1,36 @@
+#include "CoordTimeout.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+uint32_t CoordTimeout::get(uint32_t round) const {
+    uint32_t timeout = FIXED_TIMEOUT;
+    if (policy_ == TimeoutPolicy::Adaptive && has_samples_) {
+        double estimation = 2 * srtt_ + 4 * rttvar_;
+        timeout = std::clamp<double>(estimation, MIN_TIMEOUT, MAX_TIMEOUT);
+    }
+
+    // 5% of the timeout more in every round
+    return timeout + timeout / 20 * (round + 1);
+}
+
+void CoordTimeout::add_sample(uint64_t latency) {
+    if (policy_ != TimeoutPolicy::Adaptive) {
+        return;
+    }
+
+    static const double ALPHA = 1.0 / 8;
+    static const double BETA = 1.0 / 4;
+
+    double sample = latency;
+    if (!has_samples_) {
+        srtt_ = sample;
+        rttvar_ = sample / 2;
+        has_samples_ = true;
+        return;
+    }
+
+    rttvar_ = (1 - BETA) * rttvar_ + BETA * std::abs(srtt_ - sample);
+    srtt_ = (1 - ALPHA) * srtt_ + ALPHA * sample;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+enum class TimeoutPolicy {
+    Fixed,    // timeout tuned to the delays of TimerChannel
+    Adaptive, // timeout follows the observed latency of BV-delivery
+};
+
+inline const char* to_string(TimeoutPolicy policy) {
+    switch (policy) {
+        case TimeoutPolicy::Fixed: return "Fixed";
+        default:                   return "Adaptive";
+    }
+}
+
+/* timeout of the weak coordinator of psync binary consensus, shared by all instances of the node.
+   Adaptive policy estimates the latency of the first BV-delivery since the start of the round
+   like TCP RTO does: EWMA of the latency and of its deviation.
+   COORD is sent after BV-delivery at the coordinator and takes one more delay,
+   so timeout = 2 * srtt + 4 * rttvar.
+   Until the first sample the timeout is fixed. In both policies timeout grows with the round */
+class CoordTimeout {
+public:
+    CoordTimeout(TimeoutPolicy policy = TimeoutPolicy::Fixed) : policy_(policy) {
+    }
+
+    // timeout of the round in microseconds
+    uint32_t get(uint32_t round) const;
+    // latency of BV-delivery since the start of the round in microseconds
+    void add_sample(uint64_t latency);
+
+    TimeoutPolicy get_policy() const {
+        return policy_;
+    }
+
+private:
+    static const uint32_t FIXED_TIMEOUT = 10000;
+    static const uint32_t MIN_TIMEOUT = 500;
+    static const uint32_t MAX_TIMEOUT = 1000000;
+
+    TimeoutPolicy policy_;
+    bool has_samples_{false};
+    double srtt_{0};    // smoothed latency
+    double rttvar_{0};  // smoothed deviation of latency
+};
@@ -1,40 +1,61 @@
 #include "DBFT.hpp"
 #include "BinConsensus.hpp"
 
-DBFT::DBFT(uint32_t block_id, uint32_t nodes_cnt, uint32_t batch_size, INetManager& net, TransactionPool& pool, Role role) 
+namespace {
+
+std::unique_ptr<IBroadcast> make_broadcast(uint32_t nodes_cnt, INetManager& net, RBMode rb_mode) {
+    if (rb_mode == RBMode::Erasure) {
+        return std::make_unique<ErasureBroadcast>(nodes_cnt, net);
+    }
+    return std::make_unique<ReliableBroadcast>(nodes_cnt, net, rb_mode);
+}
+
+Message make_msg_base(uint32_t block_id) {
+    Message msg_base;
+    msg_base.block_id = block_id;
+    return msg_base;
+}
+
+} // namespace
+
+DBFT::DBFT(uint32_t block_id, uint32_t nodes_cnt, uint32_t batch_size, INetManager& net, TransactionPool& pool,
+           CoordTimeout& timeout, const ICoin& coin, DBFTOptions options)
     : block_id_(block_id),
       nodes_cnt_(nodes_cnt),
       batch_size_(batch_size),
       net_(net),
-      role_(role),
-      proposals_(batch_size_ * nodes_cnt_), 
-      RB_(nodes_cnt, net),
+      role_(options.role),
+      start_time_(net.now()),
+      phases_(options.phases),
+      proposals_(nodes_cnt_),
+      payloads_(nodes_cnt_),
+      RB_(make_broadcast(nodes_cnt, net, options.rb_mode)),
+      bin_cons_(nodes_cnt, nodes_cnt, net, timeout, coin, make_msg_base(block_id),
+                {.is_psync = true, .coalesce = options.coalesce, .decide_msgs = options.decide_msgs}),
       decision_(nodes_cnt_),
+      received_(nodes_cnt_),
       ready_(nodes_cnt_),
       invoked_(nodes_cnt_) {
-        // start_time_ = std::chrono::system_clock::now();
-
-        for (size_t i = 0; i < nodes_cnt_; ++i) {
-            bin_cons_.emplace_back(nodes_cnt, net, json{{"block_id", block_id_}, {"bin_con_id", i}});
+        if (phases_) {
+            bin_cons_.set_round_histogram(&phases_->round);
         }
 
-        if (role != Fair) {
-            execute_byzantine(role);
+        if (role_ != Fair) {
+            execute_byzantine(role_);
             // return;
         }
 
-        std::vector<Transaction> tx;
-        for (size_t i = 0; i < batch_size_; ++i) {
-            tx.push_back(pool.get_tx());
-        }
+        std::vector<Transaction> tx = pool.get_proposal(block_id_, batch_size_);
         proposals_[net_.get_id()] = tx;
+        received_[net_.get_id()] = 1;
 
-        json data;
-        data["block_id"] = block_id_;
-        data["transactions"] = tx;
-        data["index"] = net_.get_id();
+        Message data;
+        data.block_id = block_id_;
+        data.index = net_.get_id();
+        data.data = make_proposal(tx);
         DVLOG(3) << net_.get_id() << " DBFT RB: " << data << std::endl;
-        RB_.broadcast(data);
+        payloads_[net_.get_id()] = data;
+        RB_->broadcast(data);
         state_ = AwaitProposals;
 }
 
@@ -47,37 +68,78 @@ DBFT::DBFT(uint32_t block_id, uint32_t nodes_cnt, uint32_t batch_size, INetManag
 
 bool DBFT::process_msg(Message msg) {
     if (state_ == Consensus) {
+        // decided block can wait for the previous ones, the slower nodes still fetch its payloads
+        if (msg.type == MessageType::RB_FETCH && msg.block_id == block_id_) {
+            RB_->process_msg(std::move(msg));
+        }
         return true;
     }
 
-    if (!msg.data.contains("block_id") || msg.data["block_id"] != block_id_) {
+    if (msg.block_id != block_id_) {
         return false;
     }
 
-    if (!msg.data.contains("bin_con_id")) {
-        if (process_await_proposals(msg)) {
+    if (is_reliable_broadcast(msg.type)) {
+        if (process_await_proposals(std::move(msg))) {
             check_if_consensus();
         }
-        return state_ == Consensus;
-    }
+    } else if (msg.type == MessageType::BIN_BATCH) {
+        if (!msg.has_bin_batch()) {
+            return false;
+        }
 
-    size_t index = msg.data["bin_con_id"];
-    assert(index >= 0 && index < nodes_cnt_);
-    if (ready_[index]) {
+        // fan out the batch into the instances, parts share the header of the batch without its payload
+        Message header;
+        header.from = msg.from;
+        header.to = msg.to;
+        header.block_id = block_id_;
+        for (const BinUpdate& update : msg.bin_batch()) {
+            if (state_ == Consensus) {
+                break;
+            }
+            if (!is_bin_consensus(update.type) || update.bin_con_id >= nodes_cnt_) {
+                continue;
+            }
+
+            Message part(update.type, header);
+            part.bin_con_id = update.bin_con_id;
+            part.round = update.round;
+            part.value = update.value;
+            process_bin_msg(std::move(part));
+        }
+    } else if (is_bin_consensus(msg.type)) {
+        process_bin_msg(std::move(msg));
+    } else {
         return false;
     }
 
-    if (msg.type != "BV" && !msg.type.starts_with("BinConsensus_")) {
-        return false;
+    // messages of the instances go in batches, the rest is sent before the block is committed
+    if (state_ == Consensus) {
+        bin_cons_.flush();
+    } else {
+        bin_cons_.schedule_flush();
+    }
+    return state_ == Consensus;
+}
+
+void DBFT::process_bin_msg(Message msg) {
+    size_t index = msg.bin_con_id;
+    assert(index < nodes_cnt_);
+    if (ready_[index]) {
+        return;
     }
 
-    if (bin_cons_[index].process_msg(msg)) {
+    if (bin_cons_.process_msg(std::move(msg))) {
         ready_[index] = 1;
-        decision_[index] = bin_cons_[index].get_decision();
+        decision_[index] = bin_cons_.get_decision(index);
+        if (decision_[index] && !received_[index]) {
+            ++missing_cnt_;
+        }
+
         uint32_t fail = (nodes_cnt_ - 1) / 3;
         if (!invoked_.all() && ready_.count() >= nodes_cnt_ - fail) {
-            for (size_t i = 0; i < bin_cons_.size(); ++i) {
-                bin_cons_[i].bin_propose(0);
+            for (size_t i = 0; i < nodes_cnt_; ++i) {
+                bin_cons_.bin_propose(i, 0);
                 invoked_[i] = 1;
             }
         }
@@ -86,26 +148,21 @@ bool DBFT::process_msg(Message msg) {
 
     DVLOG(3) << net_.get_id() << " DBFT block_id: " << block_id_ << " state_: " << state_
                << " invoked_:" << invoked_ << " ready_: " << ready_ << std::endl;
+}
+
+bool DBFT::is_decided() const {
     return state_ == Consensus;
 }
 
 void DBFT::check_if_consensus() {
     if (role_ != Fair) {
-        for (size_t i = 0; i < bin_cons_.size(); ++i) {
-            if (proposals_[i].empty()) {
-                return;
-            }
+        if (received_.all()) {
+            state_ = Consensus;
         }
-        state_ = Consensus;
         return;
     }
 
-    if (ready_.all()) {
-        for (size_t i = 0; i < bin_cons_.size(); ++i) { // change to decision_ & received_ == decision_
-            if (decision_[i] == 1 && proposals_[i].empty()) {
-                return;
-            }
-        }
+    if (ready_.all() && missing_cnt_ == 0) {
         state_ = Consensus;
         set_metrics();
         DVLOG(2) << net_.get_id() << " DBFT CONSENSUS block_id: " << block_id_ << std::endl;
@@ -113,34 +170,47 @@ void DBFT::check_if_consensus() {
 }
 
 bool DBFT::process_await_proposals(Message msg) {
-    if (!msg.type.starts_with("RB_")) {
-        return false;
-    }
-
-    auto RB_res = RB_.process_msg(std::move(msg));
+    auto RB_res = RB_->process_msg(std::move(msg));
     if (!RB_res.has_value()) {
         return false;
     }
 
     // BV-delivery
     // add to bin_values_[round_] upon BV-delivery
-    json delivered_data = RB_res.value();
-    if (!delivered_data.contains("block_id") || delivered_data["block_id"] != block_id_
-        || !delivered_data.contains("transactions") || !delivered_data.contains("index")) {
+    const Message& delivered_data = RB_res.value();
+    if (delivered_data.block_id != block_id_) {
         return false;
     }
 
-    size_t index = delivered_data["index"];
-    std::vector<Transaction> tx = delivered_data["transactions"];
-    assert(index < nodes_cnt_ && !tx.empty());
+    size_t index = delivered_data.index;
+    const std::vector<Transaction>& tx = delivered_data.proposal().transactions;
+    assert(index < nodes_cnt_);
+    uint32_t fail = (nodes_cnt_ - 1) / 3;
+    if (!received_[index]) {
+        received_[index] = 1;
+        // one sample per proposer, own proposal isn't broadcast to the node
+        if (phases_) {
+            phases_->rb_delivery.record(net_.now() - start_time_);
+        }
+        if (ready_[index] && decision_[index]) {
+            --missing_cnt_;
+        }
+
+        if (received_.count() == nodes_cnt_ - fail) {
+            res_metrics_.quorum_latency = (net_.now() - start_time_) / 1e6;
+            if (phases_) {
+                phases_->quorum.record(net_.now() - start_time_);
+            }
+        }
+    }
     proposals_[index] = tx;
-    bin_cons_[index].bin_propose(1);
+    payloads_[index] = delivered_data;
+    bin_cons_.bin_propose(index, 1);
     invoked_[index] = 1;
 
-    uint32_t fail = (nodes_cnt_ - 1) / 3;
     if (state_ == AwaitProposals && ready_.count() >= nodes_cnt_ - fail) {
-        for (size_t i = 0; i < bin_cons_.size(); ++i) {
-            bin_cons_[i].bin_propose(0);
+        for (size_t i = 0; i < nodes_cnt_; ++i) {
+            bin_cons_.bin_propose(i, 0);
             invoked_[i] = 1;
         }
         state_ = AwaitBinCons;
@@ -153,11 +223,12 @@ Block DBFT::get_block(Chain& chain) {
     assert(state_ == Consensus);
 
     Block block;
-    for (size_t i = 0; i < bin_cons_.size(); ++i) {
+    ConflictIndex index;
+    for (size_t i = 0; i < nodes_cnt_; ++i) {
         if (decision_[i] == 1) {
-            std::vector<Transaction> tx_vec = proposals_[i];
-            for (auto tx : tx_vec) {
-                if (!block.conflicts(tx) && !chain.conflicts(tx)) {
+            for (auto tx : proposals_[i]) {
+                if (!index.conflicts(tx) && !chain.conflicts(tx)) {
+                    index.add(tx);
                     block.data.push_back(tx);
                 }
             }
@@ -167,32 +238,82 @@ Block DBFT::get_block(Chain& chain) {
     return block;
 }
 
+const std::vector<Transaction>& DBFT::get_proposal() const {
+    return proposals_[net_.get_id()];
+}
+
+uint64_t DBFT::get_start_time() const {
+    return start_time_;
+}
+
+const std::vector<Message>& DBFT::get_payloads() const {
+    return payloads_;
+}
+
 ConsensusMetrics DBFT::get_metrics() {
     assert(state_ == Consensus);
     if (res_metrics_.rounds_number == 0) {
-        set_rounds_number();
+        set_bin_con_metrics();
     }
     return res_metrics_;
 }
 
 void DBFT::set_metrics() {
     assert(state_ == Consensus);
-    res_metrics_.block_size = decision_.count() * batch_size_;
+    res_metrics_.block_size = 0;
+    for (size_t i = 0; i < nodes_cnt_; ++i) {
+        if (decision_[i]) {
+            res_metrics_.block_size += proposals_[i].size();
+        }
+    }
+    res_metrics_.latency = (net_.now() - start_time_) / 1e6;
+
+    if (phases_) {
+        phases_->decision.record(net_.now() - start_time_);
+        for (size_t i = 0; i < nodes_cnt_; ++i) {
+            if (bin_cons_.is_decided(i)) {
+                phases_->bin_decision.record(bin_cons_.get_metrics(i).decision_time - start_time_);
+            }
+        }
+    }
 }
 
-void DBFT::set_rounds_number() {
+void DBFT::set_bin_con_metrics() {
     assert(state_ == Consensus);
-    for (size_t i = 0; i < bin_cons_.size(); ++i) {
-        res_metrics_.rounds_number = std::max(
-            res_metrics_.rounds_number, 
-            bin_cons_[i].get_metrics().rounds_number
-        );
+    res_metrics_.rounds_number = bin_cons_.get_rounds_number();
+
+    size_t rounds_cnt = 0;
+    uint64_t rounds_time = 0;
+    size_t timers_cnt = 0;
+    size_t timeouts_cnt = 0;
+    size_t rounds_after_decision = 0;
+    size_t consensus_cnt = 0;
+    for (size_t i = 0; i < nodes_cnt_; ++i) {
+        if (!bin_cons_.reached_consensus(i)) {
+            continue;
+        }
+
+        BinConsensusMetrics metrics = bin_cons_.get_metrics(i);
+        rounds_cnt += metrics.rounds_cnt;
+        rounds_time += metrics.rounds_time;
+        timers_cnt += metrics.timers_cnt;
+        timeouts_cnt += metrics.timeouts_cnt;
+        rounds_after_decision += metrics.rounds_after_decision;
+        ++consensus_cnt;
+    }
+
+    if (rounds_cnt != 0) {
+        res_metrics_.round_latency = rounds_time / 1e6 / rounds_cnt;
+    }
+    if (timers_cnt != 0) {
+        res_metrics_.timeout_hit_rate = static_cast<double>(timeouts_cnt) / timers_cnt;
+    }
+    if (consensus_cnt != 0) {
+        res_metrics_.rounds_after_decision = static_cast<double>(rounds_after_decision) / consensus_cnt;
     }
 }
 
 void DBFT::execute_byzantine(Role role) {
-    for (size_t i = 0; i < bin_cons_.size(); ++i) {
-        bin_cons_[i].execute_byzantine(role);
-        invoked_[i] = 1;
-    }
+    bin_cons_.execute_byzantine(role);
+    invoked_.set();
 }
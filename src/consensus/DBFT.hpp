@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <vector>
 #include <string>
 #include <optional>
@@ -10,9 +11,18 @@
 #include "../core/chain.hpp"
 #include "BinConsensus.hpp"
 #include "ReliableBroadcast.hpp"
+#include "ErasureBroadcast.hpp"
 #include "metrics.hpp"
 
 
+struct DBFTOptions {
+    Role role{Fair};
+    RBMode rb_mode{RBMode::Full};
+    bool coalesce{false};       // of the binary consensuses, see BinConsensusOptions
+    bool decide_msgs{false};
+    PhaseMetrics* phases{nullptr};  // of the node, phases aren't recorded if nullptr
+};
+
 class DBFT {
 private:
     enum State {
@@ -27,17 +37,27 @@ public:
          uint32_t batch_size,
          INetManager& net,
          TransactionPool& pool,
-         Role role = Fair);
+         CoordTimeout& timeout,
+         const ICoin& coin,
+         DBFTOptions options = {});
 
     bool process_msg(Message msg);
+    bool is_decided() const;
     Block get_block(Chain& chain);
+    // transactions, which the node proposed in the block
+    const std::vector<Transaction>& get_proposal() const;
     ConsensusMetrics get_metrics();
+    // of the block at the node
+    uint64_t get_start_time() const;
+    // delivered broadcasts by proposers, empty messages of the missing ones
+    const std::vector<Message>& get_payloads() const;
 
 private:
     bool process_await_proposals(Message msg);
+    void process_bin_msg(Message msg);
     void check_if_consensus();
     void set_metrics();
-    void set_rounds_number();
+    void set_bin_con_metrics();
     void execute_byzantine(Role role);
 
 private:
@@ -53,13 +73,19 @@ private:
     INetManager& net_;
     Role role_;
 
-    // TimePoint start_time_;
+    uint64_t start_time_;   // of the block at the node
     ConsensusMetrics res_metrics_;
+    PhaseMetrics* phases_;  // of the node, phases aren't recorded if nullptr
     std::vector<std::vector<Transaction>> proposals_;
+    std::vector<Message> payloads_;     // to answer RB_FETCH of the nodes, which missed RB_INIT
     State state_;
-    ReliableBroadcast RB_;
-    std::vector<BinConsensus> bin_cons_;
+    std::unique_ptr<IBroadcast> RB_;
+    BinConsensusBatch bin_cons_;
     boost::dynamic_bitset<> decision_;
+    boost::dynamic_bitset<> received_;  // proposals can be empty, if the pool of the node is empty
     boost::dynamic_bitset<> ready_;
     boost::dynamic_bitset<> invoked_;
+
+    // counter to check consensus without scanning all proposals
+    uint32_t missing_cnt_{0};           // proposals, which are decided, but not received yet
 };
\ No newline at end of file
@@ -0,0 +1,189 @@
+#include "ErasureBroadcast.hpp"
+
+#include <cstring>
+
+namespace {
+
+std::vector<uint8_t> serialize(const Proposal& proposal) {
+    std::vector<uint8_t> bytes(proposal.transactions.size() * sizeof(Transaction));
+    std::memcpy(bytes.data(), proposal.transactions.data(), bytes.size());
+    return bytes;
+}
+
+ProposalPtr deserialize(const std::vector<uint8_t>& bytes) {
+    std::vector<Transaction> transactions(bytes.size() / sizeof(Transaction));
+    std::memcpy(transactions.data(), bytes.data(), transactions.size() * sizeof(Transaction));
+    return make_proposal(std::move(transactions));
+}
+
+} // namespace
+
+ErasureBroadcast::ErasureBroadcast(int nodes_cnt, INetManager& net)
+    : nodes_cnt_(nodes_cnt), net_(net), codec_(nodes_cnt_ - 2 * ((nodes_cnt_ - 1) / 3), nodes_cnt_) {
+}
+
+void ErasureBroadcast::broadcast(const Message& data) {
+    std::vector<uint8_t> bytes = serialize(data.proposal());
+    std::vector<Shard> shards = codec_.encode(bytes);
+
+    std::vector<Digest> digests;
+    for (const auto& shard : shards) {
+        digests.push_back(sha256(shard.data(), shard.size()));
+    }
+
+    for (uint32_t i = 0; i < nodes_cnt_; ++i) {
+        Message msg(MessageType::AVID_SEND, data);
+        msg.data = std::make_shared<const Fragment>(
+            Fragment{i, static_cast<uint32_t>(bytes.size()), digests, std::move(shards[i])});
+        msg.to = i;
+        net_.send(std::move(msg));
+    }
+}
+
+std::optional<Message> ErasureBroadcast::process_msg(Message msg) {
+    if (static_cast<uint32_t>(msg.from) >= nodes_cnt_) {
+        return std::nullopt;
+    }
+
+    switch (msg.type) {
+        case MessageType::AVID_SEND:
+        case MessageType::AVID_ECHO:
+            return msg.has_fragment() ? process_fragment(std::move(msg)) : std::nullopt;
+        case MessageType::AVID_READY:
+            break;
+        default:
+            return std::nullopt;
+    }
+
+    if (!msg.has_digest()) {
+        return std::nullopt;
+    }
+
+    Instance& instance = get_instance(msg.digest());
+    if (instance.state_ == AVID_DELIVERED) {
+        return std::nullopt;
+    }
+
+    instance.received_from_[1].insert(msg.from);
+    if (instance.state_ < AVID_READY && instance.received_from_[1].has_at_least((nodes_cnt_ - 1) / 3 + 1)) {
+        net_.broadcast(Message(MessageType::AVID_READY, msg));
+        instance.state_ = AVID_READY;
+    }
+
+    return try_deliver(instance);
+}
+
+std::optional<Message> ErasureBroadcast::process_fragment(Message msg) {
+    auto digest = verify(msg);
+    if (!digest.has_value()) {
+        return std::nullopt;
+    }
+
+    Instance& instance = get_instance(digest.value());
+    if (instance.state_ == AVID_DELIVERED) {
+        return std::nullopt;
+    }
+
+    if (instance.fragments_.empty()) {
+        instance.header_ = Message(MessageType::Undefined, msg);
+        instance.header_.data = std::monostate();
+        instance.fragments_.resize(nodes_cnt_);
+    }
+
+    const Fragment& fragment = msg.fragment();
+    if (msg.type == MessageType::AVID_SEND) {
+        // only the proposer sends fragments, every node gets its own one
+        if (static_cast<uint32_t>(msg.from) != msg.index || fragment.id != net_.get_id()) {
+            return std::nullopt;
+        }
+
+        if (instance.state_ == AVID_INIT) {
+            net_.broadcast(Message(MessageType::AVID_ECHO, std::move(msg)));
+            instance.state_ = AVID_ECHO;
+        }
+        return std::nullopt;
+    }
+
+    // AVID_ECHO, node echoes its own fragment
+    if (fragment.id != static_cast<uint32_t>(msg.from) || instance.fragments_[fragment.id]) {
+        return std::nullopt;
+    }
+
+    instance.fragments_[fragment.id] = std::get<FragmentPtr>(msg.data);
+    ++instance.fragments_cnt_;
+    instance.received_from_[0].insert(msg.from);
+
+    if (instance.state_ < AVID_READY && instance.received_from_[0].has_at_least(nodes_cnt_ - (nodes_cnt_ - 1) / 3)) {
+        Message ready(MessageType::AVID_READY, instance.header_);
+        ready.data = digest.value();
+        net_.broadcast(std::move(ready));
+        instance.state_ = AVID_READY;
+    }
+
+    return try_deliver(instance);
+}
+
+std::optional<Message> ErasureBroadcast::try_deliver(Instance& instance) {
+    if (!instance.received_from_[1].has_at_least(nodes_cnt_ - (nodes_cnt_ - 1) / 3)
+        || instance.fragments_cnt_ < codec_.get_data_cnt()) {
+        return std::nullopt;
+    }
+
+    std::vector<std::pair<uint32_t, const Shard*>> shards;
+    const Fragment* any = nullptr;
+    for (const auto& fragment : instance.fragments_) {
+        if (fragment) {
+            shards.emplace_back(fragment->id, &fragment->bytes);
+            any = fragment.get();
+        }
+    }
+
+    auto bytes = codec_.decode(shards, any->data_size);
+    if (!bytes.has_value()) {
+        return std::nullopt;
+    }
+
+    // re-encoding should give the same fragments, otherwise proposer was byzantine
+    std::vector<Shard> encoded = codec_.encode(bytes.value());
+    for (uint32_t i = 0; i < nodes_cnt_; ++i) {
+        if (sha256(encoded[i].data(), encoded[i].size()) != any->digests[i]) {
+            return std::nullopt;
+        }
+    }
+
+    Message delivered(instance.header_);
+    delivered.data = deserialize(bytes.value());
+
+    instance.state_ = AVID_DELIVERED;
+    instance.fragments_ = std::vector<FragmentPtr>();
+    for (auto& received_from : instance.received_from_) {
+        received_from.clear();
+    }
+    return delivered;
+}
+
+std::optional<Digest> ErasureBroadcast::verify(const Message& msg) const {
+    const Fragment& fragment = msg.fragment();
+    if (fragment.digests.size() != nodes_cnt_ || fragment.id >= nodes_cnt_) {
+        return std::nullopt;
+    }
+
+    if (sha256(fragment.bytes.data(), fragment.bytes.size()) != fragment.digests[fragment.id]) {
+        return std::nullopt;
+    }
+
+    return get_digest(msg, fragment.data_size, fragment.digests);
+}
+
+Digest ErasureBroadcast::get_digest(const Message& header, uint32_t data_size, const std::vector<Digest>& digests) const {
+    return Sha256()
+        .update(header.block_id)
+        .update(header.index)
+        .update(data_size)
+        .update(digests.data(), digests.size() * sizeof(Digest))
+        .finalize();
+}
+
+ErasureBroadcast::Instance& ErasureBroadcast::get_instance(const Digest& digest) {
+    return instances_.try_emplace(digest).first;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "../core/digest.hpp"
+#include "../core/erasure.hpp"
+#include "../core/flat_map.hpp"
+#include "../core/message.hpp"
+#include "../core/node_set.hpp"
+#include "../network/netmanager.hpp"
+#include "ReliableBroadcast.hpp"
+
+/* AVID-style asynchronous verifiable information dispersal (Cachin, Tessaro).
+   The proposer encodes the payload with Reed-Solomon code and sends every node
+   only its own fragment, every node echoes its fragment to all.
+   Any n - 2f fragments restore the payload. Fragments are checked against
+   the cross-checksum (digests of all fragments), instance is identified by
+   digest of (block_id, index, data_size, cross-checksum) */
+class ErasureBroadcast : public IBroadcast {
+private:
+    enum State {
+        AVID_INIT = 0,
+        AVID_ECHO = 1,
+        AVID_READY = 2,
+        AVID_DELIVERED = 3,
+    };
+
+    struct Instance {
+        State state_{AVID_INIT};
+        NodeSet received_from_[2];                      // AVID_ECHO, AVID_READY
+        Message header_;                                // block_id and index of the proposal
+        std::vector<FragmentPtr> fragments_;
+        uint32_t fragments_cnt_{0};
+    };
+
+public:
+    ErasureBroadcast(int nodes_cnt, INetManager& net);
+    void broadcast(const Message& data) override;
+    std::optional<Message> process_msg(Message msg) override;
+
+private:
+    std::optional<Message> process_fragment(Message msg);
+    std::optional<Message> try_deliver(Instance& instance);
+
+    // digest of the instance, if fragment in msg is consistent with its cross-checksum
+    std::optional<Digest> verify(const Message& msg) const;
+    Digest get_digest(const Message& header, uint32_t data_size, const std::vector<Digest>& digests) const;
+    ErasureBroadcast::Instance& get_instance(const Digest& digest);
+
+private:
+    uint32_t nodes_cnt_;
+    INetManager& net_;
+    ReedSolomon codec_;
+    FlatHashMap<Digest, Instance, DigestHash> instances_;
+};
@@ -0,0 +1,84 @@
+#include "LatencyHistogram.hpp"
+
+#include <algorithm>
+#include <bit>
+
+
+void LatencyHistogram::record(uint64_t value) {
+    value = std::min<uint64_t>(value, (uint64_t(1) << MAX_VALUE_BITS) - 1);
+    counts_[get_bucket(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+
+    uint64_t max = max_.load(std::memory_order_relaxed);
+    while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::add(const LatencyHistogram& other) {
+    for (size_t i = 0; i < BUCKETS_CNT; ++i) {
+        uint64_t count = other.counts_[i].load(std::memory_order_relaxed);
+        if (count != 0) {
+            counts_[i].fetch_add(count, std::memory_order_relaxed);
+        }
+    }
+    count_.fetch_add(other.get_count(), std::memory_order_relaxed);
+    sum_.fetch_add(other.sum_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+    uint64_t value = other.get_max();
+    uint64_t max = max_.load(std::memory_order_relaxed);
+    while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+    }
+}
+
+uint64_t LatencyHistogram::get_count() const {
+    return count_.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::get_max() const {
+    return max_.load(std::memory_order_relaxed);
+}
+
+double LatencyHistogram::get_mean() const {
+    uint64_t count = get_count();
+    return count == 0 ? 0 : static_cast<double>(sum_.load(std::memory_order_relaxed)) / count;
+}
+
+uint64_t LatencyHistogram::get_quantile(double quantile) const {
+    uint64_t count = get_count();
+    if (count == 0) {
+        return 0;
+    }
+
+    // rank of the value in sorted order, the same as for a sorted vector of values
+    uint64_t rank = std::min<uint64_t>(count - 1, quantile * count);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS_CNT; ++i) {
+        seen += counts_[i].load(std::memory_order_relaxed);
+        if (seen > rank) {
+            return get_lowest_value(i);
+        }
+    }
+    return get_max();
+}
+
+size_t LatencyHistogram::get_bucket(uint64_t value) {
+    if (value < SUB_BUCKETS_CNT) {
+        return value;
+    }
+
+    // value has the form (SUB_BUCKETS_CNT + sub_bucket) << shift
+    size_t shift = std::bit_width(value) - 1 - SUB_BUCKET_BITS;
+    size_t sub_bucket = (value >> shift) - SUB_BUCKETS_CNT;
+    return (shift + 1) * SUB_BUCKETS_CNT + sub_bucket;
+}
+
+uint64_t LatencyHistogram::get_lowest_value(size_t bucket) {
+    if (bucket < SUB_BUCKETS_CNT) {
+        return bucket;
+    }
+
+    size_t shift = bucket / SUB_BUCKETS_CNT - 1;
+    uint64_t sub_bucket = bucket % SUB_BUCKETS_CNT;
+    return (SUB_BUCKETS_CNT + sub_bucket) << shift;
+}
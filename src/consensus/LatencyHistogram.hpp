@@ -0,0 +1,43 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/* HDR-style histogram of latencies in microseconds.
+   Values below 2^SUB_BUCKET_BITS are counted exactly, larger values fall into
+   2^SUB_BUCKET_BITS linear sub-buckets of every power of 2, so the relative error is below 1 / 32.
+   Counters are atomic and updated with relaxed ordering: record() is lock-free and can be called
+   from any thread, readers see a consistent histogram after the recording threads are joined */
+class LatencyHistogram {
+public:
+    LatencyHistogram() = default;
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    void record(uint64_t value);
+    // adds the counters of other
+    void add(const LatencyHistogram& other);
+
+    uint64_t get_count() const;
+    uint64_t get_max() const;
+    double get_mean() const;
+    // lowest value of the bucket of the quantile, 0 if the histogram is empty
+    uint64_t get_quantile(double quantile) const;
+
+private:
+    static const size_t SUB_BUCKET_BITS = 5;
+    static const size_t SUB_BUCKETS_CNT = 1 << SUB_BUCKET_BITS;
+    static const size_t MAX_VALUE_BITS = 40;    // values are clamped to 2^40 us, about 12 days
+    static const size_t BUCKETS_CNT = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS_CNT;
+
+    static size_t get_bucket(uint64_t value);
+    static uint64_t get_lowest_value(size_t bucket);
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKETS_CNT> counts_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
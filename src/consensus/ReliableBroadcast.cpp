@@ -1,88 +1,162 @@
 #include "ReliableBroadcast.hpp"
 
-ReliableBroadcast::ReliableBroadcast(int nodes_cnt, INetManager& net)
-    : nodes_cnt_(nodes_cnt), net_(net) {
+ReliableBroadcast::ReliableBroadcast(int nodes_cnt, INetManager& net, RBMode mode)
+    : nodes_cnt_(nodes_cnt), net_(net), mode_(mode) {
 }
 
-void ReliableBroadcast::broadcast(const json& data) {
+void ReliableBroadcast::broadcast(const Message& data) {
     net_.broadcast(make_init(data));
-    instances_.insert({data.dump(), {RB_INIT, {}}});
+    get_instance(get_digest(data)).data_ = data;
 }
 
-std::optional<json> ReliableBroadcast::process_msg(Message msg) {
+std::optional<Message> ReliableBroadcast::process_msg(Message msg) {
     if (!check_type(msg)) {
         return std::nullopt;
     }
 
-    Instance& instance = get_instance(msg.data);
+    if (msg.type == MessageType::RB_FETCH) {
+        return process_fetch(msg);
+    }
+
+    if (msg.type == MessageType::RB_PAYLOAD) {
+        // accept payload only if it was requested
+        Instance* instance = instances_.find(get_digest(msg));
+        if (!instance || !instance->ready_quorum_ || instance->data_.has_proposal()) {
+            return std::nullopt;
+        }
+
+        instance->data_ = std::move(msg);
+        return try_deliver(*instance);
+    }
+
+    // quorums are counted only from known senders
+    if (static_cast<uint32_t>(msg.from) >= nodes_cnt_) {
+        return std::nullopt;
+    }
+
+    Instance& instance = get_instance(get_digest(msg));
     if (instance.state_ == RB_DELIVERED) {
         return std::nullopt;
     }
 
-    if (msg.type == "RB_INIT" && instance.state_ == RB_INIT) {
-        net_.broadcast(make_echo(msg.data));
+    if (msg.has_proposal() && !instance.data_.has_proposal()) {
+        instance.data_ = msg;
+    }
+
+    if (msg.type == MessageType::RB_INIT && instance.state_ == RB_INIT) {
+        net_.broadcast(make_echo(msg));
         instance.state_ = RB_ECHO;
-        return std::nullopt;
+        return try_deliver(instance);
     }
-    
-    if (msg.type == "RB_ECHO") {
+
+    if (msg.type == MessageType::RB_ECHO) {
         instance.received_from_[1].insert(msg.from);
-        if (instance.state_ < RB_READY && instance.received_from_[1].size() >= nodes_cnt_ - (nodes_cnt_ - 1) / 3) {
-            net_.broadcast(make_ready(msg.data));
+        if (instance.state_ < RB_READY && instance.received_from_[1].has_at_least(nodes_cnt_ - (nodes_cnt_ - 1) / 3)) {
+            net_.broadcast(make_ready(msg));
             instance.state_ = RB_READY;
         }
         return std::nullopt;
     }
 
-    if (msg.type == "RB_READY") {
+    if (msg.type == MessageType::RB_READY) {
         instance.received_from_[2].insert(msg.from);
-        if (instance.state_ < RB_READY && instance.received_from_[2].size() >= (nodes_cnt_ - 1) / 3 + 1) {
-            net_.broadcast(make_ready(msg.data));
+        if (instance.state_ < RB_READY && instance.received_from_[2].has_at_least((nodes_cnt_ - 1) / 3 + 1)) {
+            net_.broadcast(make_ready(msg));
             instance.state_ = RB_READY;
         }
 
-        if (instance.received_from_[2].size() >= nodes_cnt_ - (nodes_cnt_ - 1) / 3) {
-            instance.state_ = RB_DELIVERED;
-            // delete instance
-            return msg.data;
+        if (!instance.ready_quorum_ && instance.received_from_[2].has_at_least(nodes_cnt_ - (nodes_cnt_ - 1) / 3)) {
+            instance.ready_quorum_ = true;
+            if (!instance.data_.has_proposal()) {
+                // payload is known only by digest, ask for it the nodes that have it
+                net_.broadcast(Message(MessageType::RB_FETCH, msg));
+            }
         }
+
+        return try_deliver(instance);
     }
 
     return std::nullopt;
 }
 
-bool ReliableBroadcast::is_delivered(const json& data) {
-    Instance& instance = get_instance(data);
+std::optional<Message> ReliableBroadcast::process_fetch(const Message& msg) {
+    Instance* instance = instances_.find(msg.digest());
+    if (!instance || !instance->data_.has_proposal()) {
+        return std::nullopt;
+    }
+
+    Message payload(MessageType::RB_PAYLOAD, instance->data_);
+    payload.to = msg.from;
+    net_.send(std::move(payload));
+    return std::nullopt;
+}
+
+std::optional<Message> ReliableBroadcast::try_deliver(Instance& instance) {
+    if (!instance.ready_quorum_ || !instance.data_.has_proposal()) {
+        return std::nullopt;
+    }
+
+    // delivered instance is a tombstone: only state and payload (to answer RB_FETCH) are kept
+    instance.state_ = RB_DELIVERED;
+    for (auto& received_from : instance.received_from_) {
+        received_from.clear();
+    }
+    return instance.data_;
+}
+
+bool ReliableBroadcast::is_delivered(const Message& data) {
+    Instance& instance = get_instance(get_digest(data));
     return instance.state_ == RB_DELIVERED;
 }
 
-Message ReliableBroadcast::make_init(const json& data) {
-    return Message("RB_INIT", data);
+Message ReliableBroadcast::make_init(const Message& data) {
+    return Message(MessageType::RB_INIT, data);
 }
 
-Message ReliableBroadcast::make_echo(const json& data) {
-    return Message("RB_ECHO", data);
+Message ReliableBroadcast::make_echo(const Message& data) {
+    Message echo(MessageType::RB_ECHO, data);
+    if (mode_ == RBMode::Digest && echo.has_proposal()) {
+        echo.data = get_digest(data);
+    }
+    return echo;
 }
 
-Message ReliableBroadcast::make_ready(const json& data) {
-    return Message("RB_READY", data);
+Message ReliableBroadcast::make_ready(const Message& data) {
+    Message ready(MessageType::RB_READY, data);
+    if (mode_ == RBMode::Digest && ready.has_proposal()) {
+        ready.data = get_digest(data);
+    }
+    return ready;
 }
 
 bool ReliableBroadcast::check_type(const Message& msg) const {
-    const static std::vector<std::string> types = {"RB_INIT", "RB_ECHO", "RB_READY"};
-
-    for (const auto& type : types) {
-        if (msg.type == type) {
-            return true;
-        }
+    switch (msg.type) {
+        case MessageType::RB_INIT:
+        case MessageType::RB_PAYLOAD:
+            return msg.has_proposal();
+        case MessageType::RB_FETCH:
+            return msg.has_digest();
+        case MessageType::RB_ECHO:
+        case MessageType::RB_READY:
+            return msg.has_proposal() || msg.has_digest();
+        default:
+            return false;
     }
-    return false;
 }
 
-ReliableBroadcast::Instance& ReliableBroadcast::get_instance(const json& data) {
-    if (!instances_.contains(data.dump())) {
-        instances_.insert({data.dump(), {RB_INIT, {}}});
+Digest ReliableBroadcast::get_digest(const Message& data) const {
+    if (data.has_digest()) {
+        return data.digest();
     }
 
-    return instances_[data.dump()];
-}
\ No newline at end of file
+    // payload digest is cached in the shared proposal, so it's independent of batch size
+    return Sha256()
+        .update(data.block_id)
+        .update(data.index)
+        .update(data.proposal().digest)
+        .finalize();
+}
+
+ReliableBroadcast::Instance& ReliableBroadcast::get_instance(const Digest& digest) {
+    return instances_.try_emplace(digest).first;
+}
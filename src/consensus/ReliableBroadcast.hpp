@@ -1,11 +1,35 @@
 #pragma once
 
-#include <unordered_set>
-
+#include "../core/digest.hpp"
+#include "../core/flat_map.hpp"
 #include "../core/message.hpp"
+#include "../core/node_set.hpp"
 #include "../network/netmanager.hpp"
 
-class ReliableBroadcast {
+enum class RBMode {
+    Full,    // every message carries the payload
+    Digest,  // only RB_INIT carries the payload, RB_ECHO and RB_READY carry its digest
+    Erasure, // ErasureBroadcast, every node gets only a fragment of the payload
+};
+
+inline const char* to_string(RBMode mode) {
+    switch (mode) {
+        case RBMode::Full:   return "Full";
+        case RBMode::Digest: return "Digest";
+        default:             return "Erasure";
+    }
+}
+
+// delivery interface of broadcasts of proposals
+class IBroadcast {
+public:
+    virtual void broadcast(const Message& data) = 0;
+    // returns header and payload of the delivered broadcast
+    virtual std::optional<Message> process_msg(Message msg) = 0;
+    virtual ~IBroadcast() = default;
+};
+
+class ReliableBroadcast : public IBroadcast {
 private:
     enum State {
         RB_INIT = 0,
@@ -15,26 +39,34 @@ private:
     };
 
     struct Instance {
-        State state_;
-        std::unordered_set<uint32_t> received_from_[3];
+        State state_{RB_INIT};
+        NodeSet received_from_[3];
+        Message data_;                  // header and payload, if payload is already known
+        bool ready_quorum_{false};      // enough RB_READY to deliver
     };
 
 public:
-    ReliableBroadcast(int nodes_cnt, INetManager& net);
-    void broadcast(const json& data);
-    std::optional<json> process_msg(Message msg);
-    bool is_delivered(const json& data);
+    ReliableBroadcast(int nodes_cnt, INetManager& net, RBMode mode = RBMode::Full);
+    void broadcast(const Message& data) override;
+    std::optional<Message> process_msg(Message msg) override;
+    bool is_delivered(const Message& data);
 
 private:
-    Message make_init(const json& data);
-    Message make_echo(const json& data);
-    Message make_ready(const json& data);
+    Message make_init(const Message& data);
+    Message make_echo(const Message& data);
+    Message make_ready(const Message& data);
+
+    std::optional<Message> process_fetch(const Message& msg);
+    std::optional<Message> try_deliver(Instance& instance);
 
     bool check_type(const Message& msg) const;
-    ReliableBroadcast::Instance& get_instance(const json& data);
+    // instance is identified by digest of (block_id, index, payload)
+    Digest get_digest(const Message& data) const;
+    ReliableBroadcast::Instance& get_instance(const Digest& digest);
 
 private:
     uint32_t nodes_cnt_;
     INetManager& net_;
-    std::unordered_map<std::string, Instance> instances_;
-};
\ No newline at end of file
+    RBMode mode_;
+    FlatHashMap<Digest, Instance, DigestHash> instances_;
+};
@@ -1,16 +1,62 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
+#include "LatencyHistogram.hpp"
+
 struct ConsensusMetrics {
-    // double runtime{0};      // unused
-    size_t block_size{0};
+    size_t block_size{0};   // transactions in decided proposals
+    double latency{0};      // from the start of the block at the node to its decision in seconds
+    double quorum_latency{0};   // from the start of the block to n - f received proposals in seconds
 
     /* max rounds_number of all BinConsensuses
        insize Consensus Algorithm */
     size_t rounds_number{0};
+
+    // of all BinConsensuses
+    double round_latency{0};    // mean duration of a round in seconds
+    double timeout_hit_rate{0}; // part of coordinator timers, which expired before COORD was received
+    double rounds_after_decision{0}; // mean
 };
 
 struct BinConsensusMetrics {
-    // double runtime{0};      // unused
     bool decision{false};
+    uint64_t decision_time{0};  // of the node clock in microseconds, when the instance decided
     size_t rounds_number{0};
-};
\ No newline at end of file
+
+    size_t rounds_cnt{0};       // finished rounds
+    uint64_t rounds_time{0};    // duration of finished rounds in microseconds
+    size_t timers_cnt{0};       // expired timers of the coordinator
+    size_t timeouts_cnt{0};     // timers, which expired before COORD was received
+    size_t rounds_after_decision{0}; // rounds, which the instance started after decision
+};
+
+// transactions of the proposals of a node
+struct TxMetrics {
+    size_t proposed{0};
+    size_t committed{0};    // in the chain after the block of the proposal
+    size_t returned{0};     // not in the chain after the block, returned to the pool
+    size_t lost{0};         // proposed, but not in the chain at the end
+};
+/* where the latency of blocks goes: histograms of the phases of all blocks of a node in microseconds.
+   Times of the phases are since the start of the block at the node */
+struct PhaseMetrics {
+    LatencyHistogram rb_delivery;   // RB-delivery of the proposal of each node
+    LatencyHistogram quorum;        // n - f proposals are received
+    LatencyHistogram round;         // duration of each round of each binary consensus
+    LatencyHistogram bin_decision;  // decision of each binary consensus
+    LatencyHistogram decision;      // decision of the block
+    LatencyHistogram assembly;      // duration of the assembly of the block from the decided proposals
+    LatencyHistogram commit;        // the block is added to the chain after the blocks before it
+
+    void add(const PhaseMetrics& other) {
+        rb_delivery.add(other.rb_delivery);
+        quorum.add(other.quorum);
+        round.add(other.round);
+        bin_decision.add(other.bin_decision);
+        decision.add(other.decision);
+        assembly.add(other.assembly);
+        commit.add(other.commit);
+    }
+};
@@ -1,23 +1,28 @@
 #pragma once
 
-#include <unordered_set>
-
+#include "flat_map.hpp"
 #include "transaction.hpp"
+#include "tx_index.hpp"
+
+// imitation of identification of conflicts, just to test algorithm: transactions with equal keys conflict
+inline uint64_t conflict_key(Transaction tx) {
+    static const int MOD = 73;
+    return tx % MOD;
+}
 
 struct Block {
     uint32_t block_id;
     std::vector<Transaction> data;
+    uint64_t commit_time{0}; // time of the node clock in microseconds, when the block was added to the chain
 
     size_t size() {
         return data.size();
     }
 
-    // imitation of identification of conflicts, just to test algorithm
+    // linear scan, ConflictIndex is used to assemble blocks
     bool conflicts(Transaction& other_tx) {
-        static const int MOD = 73;
-
         for (auto& tx : data) {
-            if (tx == other_tx || tx % MOD == other_tx % MOD) {
+            if (tx == other_tx || conflict_key(tx) == conflict_key(other_tx)) {
                 return true;
             }
         }
@@ -36,19 +41,45 @@ struct Block {
     }
 };
 
+/* transactions of a block under assembly by their conflict keys, so conflicts of the next tx are checked in O(1).
+   Equal transactions have equal keys, so the keys are enough to find both kinds of conflicts */
+class ConflictIndex {
+public:
+    using KeyFunction = uint64_t (*)(Transaction);
+
+    explicit ConflictIndex(KeyFunction key = conflict_key) : key_(key) {
+    }
+
+    bool conflicts(Transaction tx) const {
+        return keys_.contains(key_(tx));
+    }
+
+    void add(Transaction tx) {
+        keys_.try_emplace(key_(tx));
+    }
+
+private:
+    KeyFunction key_;
+    FlatHashMap<uint64_t, bool> keys_; // keys of the transactions of the block, values aren't used
+};
+
 class Chain {
 public:
-    void add_block(Block& block) {
+    void add_block(Block& block, uint64_t commit_time = 0) {
+        block.commit_time = commit_time;
         blocks_.push_back(block);
-        for (auto& tx: block.data) {
-            all_tx_.insert(tx);
-        }
+        all_tx_.insert(block.data);
     }
 
     size_t get_height() {
         return blocks_.size();
     }
 
+    // number of unique transactions in the chain
+    size_t get_tx_cnt() {
+        return all_tx_.size();
+    }
+
     // imitation of identification of conflicts, just to test algorithm
     bool conflicts(Transaction& tx) {
         return all_tx_.contains(tx);
@@ -59,6 +90,6 @@ public:
     }
 
 private:
-    std::unordered_set<Transaction> all_tx_;
+    CommittedIndex all_tx_;
     std::vector<Block> blocks_;
 };
\ No newline at end of file
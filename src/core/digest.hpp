@@ -0,0 +1,50 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <type_traits>
+
+using Digest = std::array<uint8_t, 32>;
+
+// digests are uniformly distributed, so any 8 bytes of them are a good hash
+struct DigestHash {
+    size_t operator()(const Digest& digest) const {
+        size_t hash;
+        std::memcpy(&hash, digest.data(), sizeof(hash));
+        return hash;
+    }
+};
+
+// SHA-256, can be fed with several chunks of data
+class Sha256 {
+public:
+    Sha256();
+
+    Sha256& update(const void* data, size_t size);
+
+    template <typename T>
+    Sha256& update(const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        return update(&value, sizeof(value));
+    }
+
+    Digest finalize();
+
+private:
+    void process_block(const uint8_t* block);
+
+private:
+    uint32_t state_[8];
+    uint8_t buffer_[64];
+    size_t buffer_size_{0};
+    uint64_t total_size_{0};
+};
+
+inline Digest sha256(const void* data, size_t size) {
+    return Sha256().update(data, size).finalize();
+}
+
+std::ostream& operator<<(std::ostream& out, const Digest& digest);
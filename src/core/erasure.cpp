@@ -0,0 +1,153 @@
+#include "erasure.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+
+namespace {
+
+// arithmetic in GF(2^8) with polynomial x^8 + x^4 + x^3 + x^2 + 1
+struct GaloisField {
+    std::array<uint8_t, 512> exp;
+    std::array<uint8_t, 256> log;
+    std::array<std::array<uint8_t, 256>, 256> mul;
+
+    GaloisField() {
+        uint32_t x = 1;
+        for (uint32_t i = 0; i < 255; ++i) {
+            exp[i] = exp[i + 255] = x;
+            log[x] = i;
+            x <<= 1;
+            if (x & 0x100) {
+                x ^= 0x11d;
+            }
+        }
+        exp[510] = exp[511] = exp[0];
+        log[0] = 0;
+
+        for (uint32_t a = 0; a < 256; ++a) {
+            for (uint32_t b = 0; b < 256; ++b) {
+                mul[a][b] = (a == 0 || b == 0) ? 0 : exp[log[a] + log[b]];
+            }
+        }
+    }
+
+    uint8_t inv(uint8_t a) const {
+        assert(a != 0);
+        return exp[255 - log[a]];
+    }
+};
+
+const GaloisField& gf() {
+    static const GaloisField field;
+    return field;
+}
+
+// dst += coef * src
+void mul_add(Shard& dst, const Shard& src, uint8_t coef) {
+    if (coef == 0) {
+        return;
+    }
+
+    const auto& row = gf().mul[coef];
+    for (size_t i = 0; i < dst.size(); ++i) {
+        dst[i] ^= row[src[i]];
+    }
+}
+
+} // namespace
+
+ReedSolomon::ReedSolomon(uint32_t data_cnt, uint32_t total_cnt)
+    : data_cnt_(data_cnt), total_cnt_(total_cnt) {
+    assert(data_cnt_ > 0 && data_cnt_ <= total_cnt_ && total_cnt_ <= 256);
+}
+
+uint8_t ReedSolomon::generator(uint32_t row, uint32_t col) const {
+    if (row < data_cnt_) {
+        return row == col ? 1 : 0;
+    }
+    // Cauchy matrix 1 / (x_row + y_col), x_row = row, y_col = col, row != col
+    return gf().inv(static_cast<uint8_t>(row ^ col));
+}
+
+std::vector<Shard> ReedSolomon::encode(const std::vector<uint8_t>& data) const {
+    size_t shard_size = std::max<size_t>(1, (data.size() + data_cnt_ - 1) / data_cnt_);
+
+    std::vector<Shard> fragments(total_cnt_, Shard(shard_size, 0));
+    for (size_t i = 0; i < data.size(); ++i) {
+        fragments[i / shard_size][i % shard_size] = data[i];
+    }
+
+    for (uint32_t row = data_cnt_; row < total_cnt_; ++row) {
+        for (uint32_t col = 0; col < data_cnt_; ++col) {
+            mul_add(fragments[row], fragments[col], generator(row, col));
+        }
+    }
+
+    return fragments;
+}
+
+std::optional<std::vector<uint8_t>> ReedSolomon::decode(
+    const std::vector<std::pair<uint32_t, const Shard*>>& fragments,
+    size_t data_size) const {
+
+    if (fragments.size() < data_cnt_) {
+        return std::nullopt;
+    }
+
+    size_t shard_size = fragments[0].second->size();
+    for (uint32_t i = 0; i < data_cnt_; ++i) {
+        if (fragments[i].first >= total_cnt_ || fragments[i].second->size() != shard_size) {
+            return std::nullopt;
+        }
+    }
+
+    // invert rows of generator matrix, that correspond to the first data_cnt fragments
+    std::vector<std::vector<uint8_t>> matrix(data_cnt_, std::vector<uint8_t>(2 * data_cnt_, 0));
+    for (uint32_t row = 0; row < data_cnt_; ++row) {
+        for (uint32_t col = 0; col < data_cnt_; ++col) {
+            matrix[row][col] = generator(fragments[row].first, col);
+        }
+        matrix[row][data_cnt_ + row] = 1;
+    }
+
+    for (uint32_t col = 0; col < data_cnt_; ++col) {
+        uint32_t pivot = col;
+        while (pivot < data_cnt_ && matrix[pivot][col] == 0) {
+            ++pivot;
+        }
+        if (pivot == data_cnt_) {
+            // fragment ids are not distinct
+            return std::nullopt;
+        }
+        std::swap(matrix[col], matrix[pivot]);
+
+        const auto& scale = gf().mul[gf().inv(matrix[col][col])];
+        for (auto& value : matrix[col]) {
+            value = scale[value];
+        }
+
+        for (uint32_t row = 0; row < data_cnt_; ++row) {
+            if (row != col) {
+                mul_add(matrix[row], matrix[col], matrix[row][col]);
+            }
+        }
+    }
+
+    std::vector<uint8_t> data;
+    data.reserve(data_cnt_ * shard_size);
+    Shard shard(shard_size);
+    for (uint32_t i = 0; i < data_cnt_; ++i) {
+        std::fill(shard.begin(), shard.end(), 0);
+        for (uint32_t j = 0; j < data_cnt_; ++j) {
+            mul_add(shard, *fragments[j].second, matrix[i][data_cnt_ + j]);
+        }
+        data.insert(data.end(), shard.begin(), shard.end());
+    }
+
+    if (data.size() < data_size) {
+        return std::nullopt;
+    }
+    data.resize(data_size);
+    return data;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+using Shard = std::vector<uint8_t>;
+
+/* systematic Reed-Solomon code over GF(2^8):
+   data is split into data_cnt shards, total_cnt - data_cnt parity shards are added,
+   any data_cnt of total_cnt fragments restore the data.
+   Parity rows of generator matrix form Cauchy matrix, so any data_cnt rows are invertible */
+class ReedSolomon {
+public:
+    ReedSolomon(uint32_t data_cnt, uint32_t total_cnt);
+
+    std::vector<Shard> encode(const std::vector<uint8_t>& data) const;
+
+    // fragments are (fragment id, fragment), at least data_cnt of them with distinct ids
+    std::optional<std::vector<uint8_t>> decode(
+        const std::vector<std::pair<uint32_t, const Shard*>>& fragments,
+        size_t data_size) const;
+
+    uint32_t get_data_cnt() const {
+        return data_cnt_;
+    }
+
+private:
+    // element of generator matrix, row - fragment id, col - data shard id
+    uint8_t generator(uint32_t row, uint32_t col) const;
+
+private:
+    uint32_t data_cnt_;
+    uint32_t total_cnt_;
+};
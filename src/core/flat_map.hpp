@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <utility>
+#include <vector>
+
+/* open addressing hash map with linear probing,
+   all entries live in one contiguous array.
+   references are invalidated by insertions */
+template <typename Key, typename Value, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+class FlatHashMap {
+    using Entry = std::optional<std::pair<Key, Value>>;
+
+public:
+    FlatHashMap() : slots_(MIN_CAPACITY) {
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    bool contains(const Key& key) const {
+        return slots_[find_slot(key)].has_value();
+    }
+
+    Value* find(const Key& key) {
+        Entry& entry = slots_[find_slot(key)];
+        return entry.has_value() ? &entry->second : nullptr;
+    }
+
+    // returns the value and whether it was inserted
+    template <typename... Args>
+    std::pair<Value&, bool> try_emplace(const Key& key, Args&&... args) {
+        size_t slot = find_slot(key);
+        if (slots_[slot].has_value()) {
+            return {slots_[slot]->second, false};
+        }
+
+        if ((size_ + 1) * MAX_LOAD_DEN > slots_.size() * MAX_LOAD_NUM) {
+            rehash(slots_.size() * 2);
+            slot = find_slot(key);
+        }
+
+        slots_[slot].emplace(std::piecewise_construct,
+                             std::forward_as_tuple(key),
+                             std::forward_as_tuple(std::forward<Args>(args)...));
+        ++size_;
+        return {slots_[slot]->second, true};
+    }
+
+    bool erase(const Key& key) {
+        size_t slot = find_slot(key);
+        if (!slots_[slot].has_value()) {
+            return false;
+        }
+
+        // backward shift deletion, keeps probe sequences without tombstones
+        size_t hole = slot;
+        for (size_t next = (hole + 1) & mask(); slots_[next].has_value(); next = (next + 1) & mask()) {
+            size_t home = Hash{}(slots_[next]->first) & mask();
+            if (((next - home) & mask()) >= ((next - hole) & mask())) {
+                slots_[hole] = std::move(slots_[next]);
+                hole = next;
+            }
+        }
+        slots_[hole].reset();
+        --size_;
+        return true;
+    }
+
+    void clear() {
+        slots_.assign(MIN_CAPACITY, std::nullopt);
+        size_ = 0;
+    }
+
+private:
+    size_t mask() const {
+        return slots_.size() - 1;
+    }
+
+    // slot with the key or first empty slot of its probe sequence
+    size_t find_slot(const Key& key) const {
+        size_t slot = Hash{}(key) & mask();
+        while (slots_[slot].has_value() && !KeyEqual{}(slots_[slot]->first, key)) {
+            slot = (slot + 1) & mask();
+        }
+        return slot;
+    }
+
+    void rehash(size_t capacity) {
+        assert((capacity & (capacity - 1)) == 0);
+        std::vector<Entry> old(capacity);
+        old.swap(slots_);
+        for (auto& entry : old) {
+            if (entry.has_value()) {
+                slots_[find_slot(entry->first)] = std::move(entry);
+            }
+        }
+    }
+
+private:
+    // size should be the power of 2
+    static const size_t MIN_CAPACITY = 16;
+    static const size_t MAX_LOAD_NUM = 7;
+    static const size_t MAX_LOAD_DEN = 8;
+
+    std::vector<Entry> slots_;
+    size_t size_{0};
+};
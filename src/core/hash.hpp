@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+
+// finalizer of splitmix64: bijection, which mixes every bit of x into all bits of the result
+inline uint64_t mix64(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// output of splitmix64 with state x, so mix of 0 isn't 0
+inline uint64_t splitmix64(uint64_t x) {
+    return mix64(x + 0x9e3779b97f4a7c15ULL);
+}
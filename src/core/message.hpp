@@ -1,43 +1,242 @@
 #pragma once
 
+#include <cstdint>
 #include <iostream>
+#include <memory>
+#include <sstream>
 #include <string>
+#include <variant>
+#include <vector>
 #include <nlohmann/json.hpp>
+
+#include "digest.hpp"
+#include "transaction.hpp"
+
 using json = nlohmann::json;
 
-// enum MessageType {
-//     Transaction,
-//     Error,
-//     EST, // change to DBFT::EST
-//     AUX, // change to DBFT::AUX
-//     // types needed for reaching consensus
-// };
+enum class MessageType : uint8_t {
+    Undefined,
+
+    // ReliableBroadcast
+    RB_INIT,
+    RB_ECHO,
+    RB_READY,
+    RB_FETCH,   // request of the payload, which is known only by digest
+    RB_PAYLOAD, // response to RB_FETCH
+
+    // ErasureBroadcast
+    AVID_SEND,  // fragment from the proposer
+    AVID_ECHO,
+    AVID_READY,
+
+    // BinConsensus
+    BV,
+    AUX,
+    COORD,
+    DECIDE,     // decision of the instance, lets others stop
+    BIN_BATCH,  // BV / AUX / COORD of several instances of a block in one message
+};
+
+inline const char* to_string(MessageType type) {
+    switch (type) {
+        case MessageType::RB_INIT:  return "RB_INIT";
+        case MessageType::RB_ECHO:  return "RB_ECHO";
+        case MessageType::RB_READY: return "RB_READY";
+        case MessageType::RB_FETCH: return "RB_FETCH";
+        case MessageType::RB_PAYLOAD: return "RB_PAYLOAD";
+        case MessageType::AVID_SEND: return "AVID_SEND";
+        case MessageType::AVID_ECHO: return "AVID_ECHO";
+        case MessageType::AVID_READY: return "AVID_READY";
+        case MessageType::BV:       return "BV";
+        case MessageType::AUX:      return "BinConsensus_AUX";
+        case MessageType::COORD:    return "BinConsensus_COORD";
+        case MessageType::DECIDE:   return "BinConsensus_DECIDE";
+        case MessageType::BIN_BATCH: return "BinConsensus_BATCH";
+        default:                    return "Undefined";
+    }
+}
+
+inline bool is_reliable_broadcast(MessageType type) {
+    return type == MessageType::RB_INIT || type == MessageType::RB_ECHO || type == MessageType::RB_READY
+           || type == MessageType::RB_FETCH || type == MessageType::RB_PAYLOAD
+           || type == MessageType::AVID_SEND || type == MessageType::AVID_ECHO || type == MessageType::AVID_READY;
+}
+
+inline bool is_bin_consensus(MessageType type) {
+    return type == MessageType::BV || type == MessageType::AUX || type == MessageType::COORD
+           || type == MessageType::DECIDE;
+}
+
+// batch of transactions, proposed by one node through ReliableBroadcast
+struct Proposal {
+    std::vector<Transaction> transactions;
+    Digest digest; // of transactions, computed once on creation
+
+    bool operator==(const Proposal& other) const {
+        return digest == other.digest && transactions == other.transactions;
+    }
+};
+
+// erasure coded fragment of the proposal
+struct Fragment {
+    uint32_t id;                    // number of the fragment
+    uint32_t data_size;             // size of the encoded proposal in bytes
+    std::vector<Digest> digests;    // cross-checksum: digests of all fragments
+    std::vector<uint8_t> bytes;
+
+    bool operator==(const Fragment& other) const = default;
+};
+
+// BV / AUX / COORD of one instance, packed into BIN_BATCH
+struct BinUpdate {
+    MessageType type;
+    uint32_t bin_con_id;
+    uint32_t round;
+    uint32_t value;
+
+    bool operator==(const BinUpdate& other) const = default;
+};
+
+/* payload is immutable and shared between all copies of the message,
+   so broadcast copies only the header.
+   Digest stands for the payload, that isn't sent (digest-based RB) */
+using ProposalPtr = std::shared_ptr<const Proposal>;
+using FragmentPtr = std::shared_ptr<const Fragment>;
+using BinBatchPtr = std::shared_ptr<const std::vector<BinUpdate>>;
+using Payload = std::variant<std::monostate, ProposalPtr, Digest, FragmentPtr, BinBatchPtr>;
+
+inline ProposalPtr make_proposal(std::vector<Transaction> transactions) {
+    Digest digest = sha256(transactions.data(), transactions.size() * sizeof(Transaction));
+    return std::make_shared<const Proposal>(Proposal{std::move(transactions), digest});
+}
 
 class Message {
 public:
-    std::string type;
-    int from, to; // node ids
-    json data;
+    MessageType type{MessageType::Undefined};
+    int from{-1}, to{-1}; // node ids
+
+    // fixed header, meaning of the fields depends on type
+    uint32_t block_id{0};
+    uint32_t bin_con_id{0};
+    uint32_t round{0};
+    uint32_t value{0};  // value of BV / DECIDE or binvalues of AUX / COORD
+    uint32_t index{0};  // id of the proposer in RB
+
+    Payload data;
 
     Message() {
     }
-    Message(std::string _type) : type(_type) {
+    Message(MessageType _type) : type(_type) {
     }
-    Message(std::string _type, json _data) : type(_type), data(_data) {
+    // copy header and payload of base
+    Message(MessageType _type, Message base) : Message(std::move(base)) {
+        type = _type;
     }
 
     // if _to == -1, then broadcast
-    Message(std::string _type, json _data, int _from, int _to = -1)
-        : type(_type), from(_from), to(_to), data(_data) {
+    Message(MessageType _type, Message base, int _from, int _to = -1) : Message(std::move(base)) {
+        type = _type;
+        from = _from;
+        to = _to;
+    }
+
+    bool has_proposal() const {
+        return std::holds_alternative<ProposalPtr>(data);
+    }
+
+    const Proposal& proposal() const {
+        return *std::get<ProposalPtr>(data);
+    }
+
+    bool has_fragment() const {
+        return std::holds_alternative<FragmentPtr>(data);
+    }
+
+    const Fragment& fragment() const {
+        return *std::get<FragmentPtr>(data);
+    }
+
+    bool has_bin_batch() const {
+        return std::holds_alternative<BinBatchPtr>(data);
+    }
+
+    const std::vector<BinUpdate>& bin_batch() const {
+        return *std::get<BinBatchPtr>(data);
+    }
+
+    bool has_digest() const {
+        return std::holds_alternative<Digest>(data);
+    }
+
+    const Digest& digest() const {
+        return std::get<Digest>(data);
+    }
+
+    bool same_payload(const Message& other) const {
+        if (has_proposal() && other.has_proposal()) {
+            return proposal() == other.proposal();
+        }
+        if (has_fragment() && other.has_fragment()) {
+            return fragment() == other.fragment();
+        }
+        if (has_bin_batch() && other.has_bin_batch()) {
+            return bin_batch() == other.bin_batch();
+        }
+        return data == other.data;
     }
 
     bool operator==(const Message& other) const {
-        return type == other.type && to == other.to && from == other.from 
-               && data == other.data;
+        return type == other.type && to == other.to && from == other.from
+               && block_id == other.block_id && bin_con_id == other.bin_con_id
+               && round == other.round && value == other.value && index == other.index
+               && same_payload(other);
+    }
+
+    // approximate size of the message on the wire, in bytes
+    size_t wire_size() const {
+        static const size_t HEADER_SIZE = sizeof(type) + 2 * sizeof(int32_t) + 5 * sizeof(uint32_t);
+
+        size_t size = HEADER_SIZE;
+        if (has_proposal()) {
+            size += proposal().transactions.size() * sizeof(Transaction);
+        } else if (has_digest()) {
+            size += sizeof(Digest);
+        } else if (has_fragment()) {
+            size += 2 * sizeof(uint32_t) + fragment().digests.size() * sizeof(Digest) + fragment().bytes.size();
+        } else if (has_bin_batch()) {
+            size += bin_batch().size() * (sizeof(MessageType) + 3 * sizeof(uint32_t));
+        }
+        return size;
+    }
+
+    // debug view of the message
+    json to_json() const {
+        json res{{"block_id", block_id}};
+        if (is_reliable_broadcast(type)) {
+            res["index"] = index;
+        } else if (is_bin_consensus(type)) {
+            res["bin_con_id"] = bin_con_id;
+            res["round"] = round;
+            bool is_value = type == MessageType::BV || type == MessageType::DECIDE;
+            res[is_value ? "value" : "binvalues"] = value;
+        }
+
+        if (has_proposal()) {
+            res["transactions"] = proposal().transactions;
+        } else if (has_digest()) {
+            std::ostringstream out;
+            out << digest();
+            res["digest"] = out.str();
+        } else if (has_fragment()) {
+            res["fragment"] = fragment().id;
+        } else if (has_bin_batch()) {
+            res["updates"] = bin_batch().size();
+        }
+        return res;
     }
 
-    friend std::ostream& operator<<(std::ostream& out, Message msg) {
-        out << "{" << msg.type << ", " << msg.data << "}";
+    friend std::ostream& operator<<(std::ostream& out, const Message& msg) {
+        out << "{" << to_string(msg.type) << ", " << msg.to_json() << "}";
         return out;
     }
-};
\ No newline at end of file
+};
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* set of node ids as a dense bitset indexed by node id.
+   Ids < 64 are stored inline, larger ids use words on the heap,
+   so for small networks the set doesn't allocate at all */
+class NodeSet {
+public:
+    // returns true if id wasn't in the set
+    bool insert(uint32_t id) {
+        uint64_t& word = get_word(id);
+        uint64_t bit = uint64_t(1) << (id % WORD_BITS);
+        if (word & bit) {
+            return false;
+        }
+
+        word |= bit;
+        return true;
+    }
+
+    bool contains(uint32_t id) const {
+        uint32_t index = id / WORD_BITS;
+        uint64_t word = index == 0 ? inline_ : (index <= words_.size() ? words_[index - 1] : 0);
+        return word & (uint64_t(1) << (id % WORD_BITS));
+    }
+
+    size_t size() const {
+        size_t size = std::popcount(inline_);
+        for (uint64_t word : words_) {
+            size += std::popcount(word);
+        }
+        return size;
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    // quorum check without counting past the threshold
+    bool has_at_least(size_t threshold) const {
+        size_t size = std::popcount(inline_);
+        for (size_t i = 0; i < words_.size() && size < threshold; ++i) {
+            size += std::popcount(words_[i]);
+        }
+        return size >= threshold;
+    }
+
+    void clear() {
+        inline_ = 0;
+        words_ = std::vector<uint64_t>();
+    }
+
+private:
+    uint64_t& get_word(uint32_t id) {
+        uint32_t index = id / WORD_BITS;
+        if (index == 0) {
+            return inline_;
+        }
+
+        if (words_.size() < index) {
+            words_.resize(index);
+        }
+        return words_[index - 1];
+    }
+
+private:
+    static const uint32_t WORD_BITS = 64;
+
+    uint64_t inline_{0};
+    std::vector<uint64_t> words_; // ids from 64 on
+};
+
+/* rows of NodeSets in one contiguous array, e.g. senders for every instance of a batch.
+   Ids should be less than nodes_cnt, sizes of rows are counted on insertion */
+class NodeSetArray {
+public:
+    NodeSetArray(size_t rows, uint32_t nodes_cnt)
+        : words_cnt_(std::max<uint32_t>((nodes_cnt + WORD_BITS - 1) / WORD_BITS, 1)),
+          words_(rows * words_cnt_),
+          sizes_(rows) {
+    }
+
+    // returns true if id wasn't in the row
+    bool insert(size_t row, uint32_t id) {
+        assert(id < words_cnt_ * WORD_BITS);
+        uint64_t& word = words_[row * words_cnt_ + id / WORD_BITS];
+        uint64_t bit = uint64_t(1) << (id % WORD_BITS);
+        if (word & bit) {
+            return false;
+        }
+
+        word |= bit;
+        ++sizes_[row];
+        return true;
+    }
+
+    bool contains(size_t row, uint32_t id) const {
+        if (id >= words_cnt_ * WORD_BITS) {
+            return false;
+        }
+        return words_[row * words_cnt_ + id / WORD_BITS] & (uint64_t(1) << (id % WORD_BITS));
+    }
+
+    uint32_t size(size_t row) const {
+        return sizes_[row];
+    }
+
+private:
+    static const uint32_t WORD_BITS = 64;
+
+    uint32_t words_cnt_; // per row
+    std::vector<uint64_t> words_;
+    std::vector<uint32_t> sizes_;
+};
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <random>
 #include "transaction.hpp"
 
@@ -5,4 +6,164 @@ Transaction gen_tx() {
     static std::mt19937 gen = std::mt19937(std::random_device()());
     static auto rand_engine = std::uniform_int_distribution<>(1);
     return rand_engine(gen);
-}
\ No newline at end of file
+}
+TransactionPool::~TransactionPool() {
+    Submission* submission = submissions_.exchange(nullptr);
+    while (submission) {
+        Submission* next = submission->next;
+        delete submission;
+        submission = next;
+    }
+}
+
+void TransactionPool::submit(Transaction tx) {
+    submit(std::vector<Transaction>{tx});
+}
+
+void TransactionPool::submit(std::vector<Transaction> txs) {
+    Submission* submission = new Submission{std::move(txs), submissions_.load(std::memory_order_relaxed)};
+    while (!submissions_.compare_exchange_weak(submission->next, submission,
+                                               std::memory_order_release, std::memory_order_relaxed)) {
+    }
+}
+
+void TransactionPool::schedule(std::vector<Arrival> arrivals) {
+    scheduled_.insert(scheduled_.end(), arrivals.begin(), arrivals.end());
+    std::stable_sort(scheduled_.begin(), scheduled_.end(), [](const Arrival& lhs, const Arrival& rhs) {
+        return lhs.time < rhs.time;
+    });
+}
+
+void TransactionPool::release(uint64_t now) {
+    while (!scheduled_.empty() && scheduled_.front().time <= now) {
+        add_tx(scheduled_.front().tx);
+        scheduled_.pop_front();
+    }
+}
+
+Transaction TransactionPool::get_tx() {
+    std::vector<Transaction> tx = take(1);
+    assert(!tx.empty());
+    return tx.front();
+}
+
+std::vector<Transaction> TransactionPool::take(size_t cnt) {
+    drain();
+    std::vector<Transaction> tx;
+    for (size_t i = 0; i < pools_.size() && tx.size() < cnt; ++i) {
+        take(pools_[i], cnt, tx);
+    }
+    return tx;
+}
+
+std::vector<Transaction> TransactionPool::get_proposal(size_t block_id, size_t cnt) {
+    drain();
+    // transactions of the other slots are proposed by the other replicas in this block
+    std::vector<Transaction> tx;
+    take(pools_[block_id % pools_.size()], cnt, tx);
+    return tx;
+}
+
+size_t TransactionPool::size() {
+    drain();
+    return pending_.size();
+}
+
+void TransactionPool::add_tx(Transaction tx) {
+    if (is_foreign(tx)) {
+        return;
+    }
+
+    if (pending_.try_emplace(tx).second) {
+        pools_[get_pool(tx)].push_back(tx);
+    }
+}
+
+void TransactionPool::return_tx(Transaction tx) {
+    if (is_foreign(tx)) {
+        return;
+    }
+
+    if (pending_.try_emplace(tx).second) {
+        pools_[get_pool(tx)].push_front(tx);
+    }
+}
+
+void TransactionPool::return_tx(const std::vector<Transaction>& txs) {
+    for (auto it = txs.rbegin(); it != txs.rend(); ++it) {
+        return_tx(*it);
+    }
+}
+
+void TransactionPool::set_partition(uint32_t node_id, TxPartition partition) {
+    drain();
+    node_id_ = node_id;
+    partition_ = partition;
+    partitioned_ = true;
+
+    std::vector<std::deque<Transaction>> pools(partition_.replicas_cnt);
+    std::swap(pools, pools_);
+    FlatHashMap<Transaction, bool, TxHash> pending;
+    std::swap(pending, pending_);
+    for (auto& pool : pools) {
+        for (Transaction tx : pool) {
+            if (pending.contains(tx)) {
+                add_tx(tx);
+            }
+        }
+    }
+}
+
+void TransactionPool::commit(const std::vector<Transaction>& txs) {
+    for (Transaction tx : txs) {
+        pending_.erase(tx);
+    }
+}
+
+void TransactionPool::drain() {
+    Submission* submission = submissions_.exchange(nullptr, std::memory_order_acquire);
+    // the stack is reversed to the order of submission
+    Submission* first = nullptr;
+    while (submission) {
+        Submission* next = submission->next;
+        submission->next = first;
+        first = submission;
+        submission = next;
+    }
+
+    while (first) {
+        for (Transaction tx : first->txs) {
+            add_tx(tx);
+        }
+        Submission* next = first->next;
+        delete first;
+        first = next;
+    }
+}
+
+bool TransactionPool::is_foreign(Transaction tx) const {
+    return partitioned_ && !partition_.is_replica(tx, node_id_);
+}
+
+size_t TransactionPool::get_pool(Transaction tx) const {
+    if (!partitioned_) {
+        return 0;
+    }
+
+    // foreign transactions aren't added to the pools
+    uint32_t replica = (node_id_ + partition_.nodes_cnt - partition_.get_home(tx)) % partition_.nodes_cnt;
+    assert(replica < partition_.replicas_cnt);
+    return (replica + partition_.replicas_cnt - partition_.get_slot(tx, 0)) % partition_.replicas_cnt;
+}
+
+void TransactionPool::take(std::deque<Transaction>& pool, size_t cnt, std::vector<Transaction>& tx) {
+    // the taken prefix is erased from the pool at once
+    auto it = pool.begin();
+    for (; it != pool.end() && tx.size() < cnt; ++it) {
+        // committed transactions are skipped
+        if (pending_.erase(*it)) {
+            tx.push_back(*it);
+        }
+    }
+    pool.erase(pool.begin(), it);
+}
@@ -1,30 +1,129 @@
 #pragma once
 
+#include <atomic>
 #include <cassert>
+#include <cstdint>
 #include <deque>
+#include <functional>
+#include <vector>
+
+#include "flat_map.hpp"
+#include "hash.hpp"
 
 using Transaction = uint64_t;
 
 Transaction gen_tx();
 
-class TransactionPool {
-public:
-    Transaction get_tx() {
-        assert(!pool_.empty());
-        Transaction tx = std::move(pool_.front());
-        pool_.pop_front();
-        return tx;
+/* std::hash is identity for integers, consecutive ids would make one long probe sequence
+   in open addressing tables, so the bits are mixed by the finalizer of splitmix64 */
+struct TxHash {
+    size_t operator()(Transaction tx) const {
+        return mix64(tx);
+    }
+};
+
+/* every tx is replicated to replicas_cnt consecutive nodes from its home node,
+   so at least one of them is fair. In a block the tx is proposed only by the replica of its slot,
+   the slot moves to the next replica in the next block, so proposals of the nodes are disjoint,
+   and a tx, which wasn't committed, is proposed again by the next replica */
+struct TxPartition {
+    uint32_t nodes_cnt{1};
+    uint32_t replicas_cnt{1};
+
+    uint32_t get_home(Transaction tx) const {
+        return std::hash<Transaction>{}(tx) % nodes_cnt;
     }
 
-    void add_tx(Transaction tx) {
-        pool_.push_back(std::move(tx));
+    bool is_replica(Transaction tx, uint32_t node_id) const {
+        return (node_id + nodes_cnt - get_home(tx)) % nodes_cnt < replicas_cnt;
     }
 
-    // in case tx wasn't decided in consensus algorithm
-    void return_tx(Transaction tx) {
-        pool_.push_front(std::move(tx));
+    // index of the replica, which proposes tx in the block
+    uint32_t get_slot(Transaction tx, size_t block_id) const {
+        return (std::hash<Transaction>{}(tx) / nodes_cnt + block_id) % replicas_cnt;
     }
+};
+
+// tx, which arrives at the pool at time of the node clock in microseconds
+struct Arrival {
+    uint64_t time;
+    Transaction tx;
+};
+
+/* transactions, which the node can propose.
+   Clients submit transactions from any thread: submissions are pushed to a lock-free stack,
+   which the node takes at once and moves to the pools before it reads them.
+   The rest of the methods are called only by the node.
+   Transactions are deduplicated by id: a tx, which is already in the pool, isn't added again */
+class TransactionPool {
+public:
+    TransactionPool() = default;
+    TransactionPool(const TransactionPool&) = delete;
+    TransactionPool& operator=(const TransactionPool&) = delete;
+    ~TransactionPool();
+
+    // thread-safe
+    void submit(Transaction tx);
+    // thread-safe, one push for the whole batch
+    void submit(std::vector<Transaction> txs);
+
+    // transactions are added to the pool at their arrival times by release(), called before the node runs
+    void schedule(std::vector<Arrival> arrivals);
+    // adds scheduled transactions, which arrived by now
+    void release(uint64_t now);
+
+    Transaction get_tx();
+
+    // at most cnt transactions from the front of the pool
+    std::vector<Transaction> take(size_t cnt);
+
+    /* at most cnt transactions, which the node proposes in the block, empty if the pool has none of its slot.
+       Transactions of the other slots wait for their blocks, so replicas never propose a tx in the same block */
+    std::vector<Transaction> get_proposal(size_t block_id, size_t cnt);
+
+    // number of transactions, which the node can propose
+    size_t size();
+
+    void add_tx(Transaction tx);
+
+    // in case tx wasn't decided in consensus algorithm
+    void return_tx(Transaction tx);
+
+    // returned transactions keep their order in front of the pool
+    void return_tx(const std::vector<Transaction>& txs);
+
+    // the node proposes its transactions only in blocks of their slots, transactions of other nodes are dropped
+    void set_partition(uint32_t node_id, TxPartition partition);
+
+    // committed transactions aren't proposed anymore
+    void commit(const std::vector<Transaction>& txs);
 
 private:
-    std::deque<Transaction> pool_;
-};
\ No newline at end of file
+    struct Submission {
+        std::vector<Transaction> txs;
+        Submission* next;
+    };
+
+    // moves submitted transactions to the pools in order of submission
+    void drain();
+
+    // the node isn't a replica of tx, so it never proposes tx
+    bool is_foreign(Transaction tx) const;
+
+    // pool i has transactions, which the node proposes in blocks with block_id % replicas_cnt == i
+    size_t get_pool(Transaction tx) const;
+
+    void take(std::deque<Transaction>& pool, size_t cnt, std::vector<Transaction>& tx);
+
+private:
+    std::atomic<Submission*> submissions_{nullptr}; // stack, the last submission on top
+
+    std::vector<std::deque<Transaction>> pools_{1};
+    // transactions in the pools, committed ones are removed from pools_ lazily
+    FlatHashMap<Transaction, bool, TxHash> pending_;
+    std::deque<Arrival> scheduled_; // by arrival time
+
+    bool partitioned_{false};
+    uint32_t node_id_{0};
+    TxPartition partition_;
+};
@@ -0,0 +1,150 @@
+#include "tx_index.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+
+#include "hash.hpp"
+
+BlockedBloomFilter::BlockedBloomFilter(size_t keys_cnt)
+    : blocks_(std::max<size_t>(1, (keys_cnt * BITS_PER_KEY + BITS_PER_BLOCK - 1) / BITS_PER_BLOCK)) {
+}
+
+void BlockedBloomFilter::insert(Transaction tx) {
+    uint64_t hash = splitmix64(tx);
+    Block& block = blocks_[hash % blocks_.size()];
+    // bits in the block are taken from 9-bit parts of the second hash
+    uint64_t bits = splitmix64(hash);
+    for (size_t i = 0; i < HASHES_CNT; ++i, bits >>= 9) {
+        uint32_t bit = bits % BITS_PER_BLOCK;
+        block.words[bit / 64] |= uint64_t(1) << (bit % 64);
+    }
+}
+
+bool BlockedBloomFilter::may_contain(Transaction tx) const {
+    uint64_t hash = splitmix64(tx);
+    const Block& block = blocks_[hash % blocks_.size()];
+    uint64_t bits = splitmix64(hash);
+    for (size_t i = 0; i < HASHES_CNT; ++i, bits >>= 9) {
+        uint32_t bit = bits % BITS_PER_BLOCK;
+        if (!(block.words[bit / 64] & (uint64_t(1) << (bit % 64)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+CommittedIndex::Run::Run(std::vector<Transaction> sorted_txs) : txs(std::move(sorted_txs)), filter(txs.size()) {
+    fences.reserve(txs.size() / FENCE_STEP + 1);
+    for (size_t i = 0; i < txs.size(); ++i) {
+        filter.insert(txs[i]);
+        if (i % FENCE_STEP == 0) {
+            fences.push_back(txs[i]);
+        }
+    }
+}
+
+bool CommittedIndex::Run::contains(Transaction tx) const {
+    if (!filter.may_contain(tx)) {
+        return false;
+    }
+
+    // the last fence not greater than tx
+    auto fence = std::upper_bound(fences.begin(), fences.end(), tx);
+    if (fence == fences.begin()) {
+        return false;
+    }
+    size_t first = (fence - fences.begin() - 1) * FENCE_STEP;
+    auto begin = txs.begin() + first;
+    auto end = txs.begin() + std::min(first + FENCE_STEP, txs.size());
+    return std::binary_search(begin, end, tx);
+}
+
+bool CommittedIndex::contains(Transaction tx) const {
+    if (std::binary_search(buffer_.begin(), buffer_.end(), tx)) {
+        return true;
+    }
+
+    // new transactions are looked up more often
+    for (auto it = runs_.rbegin(); it != runs_.rend(); ++it) {
+        if ((*it)->contains(tx)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void CommittedIndex::insert(const std::vector<Transaction>& txs) {
+    std::vector<Transaction> fresh;
+    for (Transaction tx : txs) {
+        if (!contains(tx)) {
+            fresh.push_back(tx);
+        }
+    }
+    std::sort(fresh.begin(), fresh.end());
+    fresh.erase(std::unique(fresh.begin(), fresh.end()), fresh.end());
+
+    size_t old_size = buffer_.size();
+    buffer_.insert(buffer_.end(), fresh.begin(), fresh.end());
+    std::inplace_merge(buffer_.begin(), buffer_.begin() + old_size, buffer_.end());
+    size_ += fresh.size();
+
+    if (buffer_.size() >= BUFFER_SIZE) {
+        flush_buffer();
+    }
+    compact();
+}
+
+size_t CommittedIndex::memory() const {
+    size_t memory = buffer_.capacity() * sizeof(Transaction);
+    for (const RunPtr& run : runs_) {
+        memory += (run->txs.capacity() + run->fences.capacity()) * sizeof(Transaction) + run->filter.memory();
+    }
+    return memory;
+}
+
+void CommittedIndex::wait_compaction() {
+    // merged run can be merged again
+    while (merged_.valid()) {
+        merged_.wait();
+        compact();
+    }
+}
+
+CommittedIndex::RunPtr CommittedIndex::merge(const RunPtr& older, const RunPtr& newer) {
+    std::vector<Transaction> txs;
+    txs.reserve(older->txs.size() + newer->txs.size());
+    std::merge(older->txs.begin(), older->txs.end(), newer->txs.begin(), newer->txs.end(), std::back_inserter(txs));
+    return std::make_shared<const Run>(std::move(txs));
+}
+
+void CommittedIndex::flush_buffer() {
+    runs_.push_back(std::make_shared<const Run>(std::move(buffer_)));
+    buffer_ = std::vector<Transaction>();
+    buffer_.reserve(BUFFER_SIZE);
+}
+
+void CommittedIndex::compact() {
+    if (merged_.valid()) {
+        if (merged_.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            return;
+        }
+
+        // new runs are only appended, so the merged runs are at the same place
+        runs_[merged_first_] = merged_.get();
+        runs_.erase(runs_.begin() + merged_first_ + 1);
+    }
+
+    // the newest pair of runs, where the older one isn't much larger than the newer one
+    for (size_t i = runs_.size(); i >= 2; --i) {
+        const RunPtr& older = runs_[i - 2];
+        const RunPtr& newer = runs_[i - 1];
+        if (older->txs.size() <= 2 * newer->txs.size()) {
+            merged_first_ = i - 2;
+            merged_ = std::async(std::launch::async, [older, newer] {
+                return merge(older, newer);
+            });
+            return;
+        }
+    }
+}
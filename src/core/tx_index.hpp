@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include "transaction.hpp"
+
+/* Bloom filter, which sets all bits of a key in one cache line,
+   so a lookup touches one line of memory. BITS_PER_KEY bits per key give ~1% of false positives */
+class BlockedBloomFilter {
+public:
+    explicit BlockedBloomFilter(size_t keys_cnt);
+
+    void insert(Transaction tx);
+    bool may_contain(Transaction tx) const;
+
+    size_t memory() const {
+        return blocks_.size() * sizeof(Block);
+    }
+
+private:
+    static const size_t BITS_PER_KEY = 10;
+    static const size_t BITS_PER_BLOCK = 512;
+    static const size_t HASHES_CNT = 6;
+
+    struct alignas(64) Block {
+        uint64_t words[BITS_PER_BLOCK / 64]{};
+    };
+
+    std::vector<Block> blocks_;
+};
+
+/* exact set of committed transactions with a small constant of memory per tx.
+   Recent transactions are kept in a small sorted buffer, full buffers become immutable sorted runs
+   with Bloom filters. Runs of similar sizes are merged in the background, while lookups use the old runs,
+   so there are O(log(size / BUFFER_SIZE)) runs. A lookup checks the buffer and filters of the runs,
+   and searches only runs, whose filters may contain the tx.
+   Not thread-safe: insertions and lookups are made by the node, only merging runs is done in the background */
+class CommittedIndex {
+public:
+    CommittedIndex() = default;
+    CommittedIndex(const CommittedIndex&) = delete;
+    CommittedIndex& operator=(const CommittedIndex&) = delete;
+
+    bool contains(Transaction tx) const;
+    // transactions of a block, already committed ones are skipped
+    void insert(const std::vector<Transaction>& txs);
+
+    size_t size() const {
+        return size_;
+    }
+
+    size_t get_runs_cnt() const {
+        return runs_.size();
+    }
+
+    // bytes of the buffer, runs and filters
+    size_t memory() const;
+
+    // waits, until no runs are left to merge, e.g. before measurements
+    void wait_compaction();
+
+private:
+    struct Run {
+        explicit Run(std::vector<Transaction> sorted_txs);
+        bool contains(Transaction tx) const;
+
+        std::vector<Transaction> txs; // sorted
+        // every FENCE_STEP-th tx, the search in a large run starts in this small array, which stays in cache
+        std::vector<Transaction> fences;
+        BlockedBloomFilter filter;
+    };
+    using RunPtr = std::shared_ptr<const Run>;
+
+    static RunPtr merge(const RunPtr& older, const RunPtr& newer);
+
+    void flush_buffer();
+    // applies the finished merge and starts the next one
+    void compact();
+
+private:
+    static const size_t BUFFER_SIZE = 4096;
+    static const size_t FENCE_STEP = 64;
+
+    size_t size_{0};
+    std::vector<Transaction> buffer_;   // sorted
+    std::vector<RunPtr> runs_;          // from old to new
+
+    // of runs_[merged_first_] and runs_[merged_first_ + 1], destructor of the future waits for the merge
+    std::future<RunPtr> merged_;
+    size_t merged_first_{0};
+};
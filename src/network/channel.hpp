@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
 #include <glog/logging.h>
@@ -8,11 +9,19 @@
 #include <optional>
 #include <random>
 #include <deque>
+#include <thread>
 
 #include "../core/message.hpp"
+#include "timing_wheel.hpp"
 
 class Sender;
 
+// time of real networks, in microseconds
+inline uint64_t steady_now() {
+    auto since_epoch = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::microseconds>(since_epoch).count();
+}
+
 class IChannel {
 public:
     virtual void set_handler(std::function<void(Message)>) = 0;
@@ -24,6 +33,11 @@ public:
     virtual void stop() = 0;
     virtual void set_timer(uint32_t, std::function<void()>) = 0;
     virtual void set_invasion_data(bool, uint32_t) = 0; // InvasionConfig?
+    // starts event loop of the owner: start() is called in it, then messages are handled until stop()
+    virtual void run(std::function<void()> start) = 0;
+    virtual void join() = 0;
+    // current time in microseconds
+    virtual uint64_t now() = 0;
     virtual ~IChannel() = default;
 
 public:
@@ -49,6 +63,70 @@ private:
     IChannel& channel_;
 };
 
+/* imitation of the byzantine network scheduler:
+   RB_READY of proposals f..2f-1 to nodes f..2f-1 are held back
+   until these nodes get AUX from nodes f..2f-1 in binary consensuses f..2f-1
+   (on its own or in BIN_BATCH) */
+class ByzantineInvasion {
+public:
+    void set_data(bool invasion, uint32_t nodes_cnt) {
+        invasion_ = invasion;
+        nodes_cnt_ = nodes_cnt;
+    }
+
+    // returns true if msg is held back, held messages, which should be handled now, are moved to released
+    bool intercept(const Message& msg, std::deque<Message>& released) {
+        if (!invasion_) {
+            return false;
+        }
+
+        assert(nodes_cnt_ != 0);
+        uint32_t f = (nodes_cnt_ - 1) / 3;
+        auto from_f_to_2f = [f](uint32_t value) { return value >= f && value < 2 * f; };
+        if (!from_f_to_2f(msg.to)) {
+            return false;
+        }
+
+        if (msg.type == MessageType::RB_READY || msg.type == MessageType::AVID_READY) {
+            if (from_f_to_2f(msg.index)) {
+                VLOG(5) << "EXTRACTED " << msg << std::endl;
+                extracted_msgs_.push_back(msg);
+                return true;
+            }
+        } else if (msg.type == MessageType::AUX || msg.type == MessageType::BIN_BATCH) {
+            if (!from_f_to_2f(msg.from)) {
+                return false;
+            }
+
+            auto is_AUX_from_f_to_2f = [&](MessageType type, uint32_t bin_con_id) {
+                return type == MessageType::AUX && from_f_to_2f(bin_con_id);
+            };
+            if (msg.type == MessageType::AUX && !is_AUX_from_f_to_2f(msg.type, msg.bin_con_id)) {
+                return false;
+            }
+            if (msg.type == MessageType::BIN_BATCH
+                && (!msg.has_bin_batch()
+                    || std::none_of(msg.bin_batch().begin(), msg.bin_batch().end(), [&](const BinUpdate& update) {
+                           return is_AUX_from_f_to_2f(update.type, update.bin_con_id);
+                       }))) {
+                return false;
+            }
+
+            VLOG(5) << "BYZ_INVASION: got msg: " << msg.from << " " << msg.to << msg << " START TO EXTRACT" << std::endl;
+            while (!extracted_msgs_.empty()) {
+                released.push_back(std::move(extracted_msgs_.front()));
+                extracted_msgs_.pop_front();
+            }
+        }
+        return false;
+    }
+
+private:
+    bool invasion_{false};
+    uint32_t nodes_cnt_{0};
+    std::deque<Message> extracted_msgs_;
+};
+
 class Channel : public IChannel {
 public:
     // size should be the power of 2
@@ -124,19 +202,40 @@ public:
     void set_invasion_data(bool, uint32_t) override {
     }
 
+    void run(std::function<void()> start) override {
+        loop_ = std::thread([this, start = std::move(start)]() {
+            start();
+            handle_messages();
+        });
+    }
+
+    void join() override {
+        if (loop_.joinable()) {
+            loop_.join();
+        }
+    }
+
+    uint64_t now() override {
+        return steady_now();
+    }
+
 
 private:
     const static uint32_t SIZE = 1 << 17;
     boost::fibers::buffered_channel<Message> channel_;
+    std::thread loop_;
 };
 
 //////////////////////////////////////////// TimerChannel ///////////////////////////////////////////////
 
 namespace asio = boost::asio;
 
+/* deliveries and timers are entries of the timing wheel of the channel,
+   one steady_timer is armed to the earliest of them, expired entries are handled in one batch.
+   The channel has no thread: its handlers run on the workers of the pool in its strand */
 class TimerChannel : public IChannel {
 public:
-    TimerChannel() : ctx_(1), ctx_guard_(make_work_guard(ctx_)) {
+    TimerChannel(asio::io_context& ctx) : strand_(asio::make_strand(ctx)), timer_(strand_), wheel_(steady_now()) {
     }
 
     TimerChannel(const TimerChannel&) = delete;
@@ -158,44 +257,28 @@ public:
     }
 
     void send(Message msg) override {
-        using namespace asio;
         // assert(handler_ != default_handler);
-        ++size_;
         if (is_stopped_) {
-            --size_;
             return;
         }
 
-        steady_timer* timer = new steady_timer(ctx_);
-        timer->expires_after(get_delay());
-        timer->async_wait([this, timer, msg = std::move(msg)] (const boost::system::error_code&) {
-            delete timer;
-
-            if (this->is_stopped_) {
-                --size_;
-                return;
-            }
-
-            if (!byzantine_invasion(msg)) {
-                handler_(msg);
-            }
-            --size_;
-        });
+        ++size_;
+        schedule(get_delay(), std::move(msg));
     }
 
     std::optional<Message> receive() override {
         return std::nullopt;
     }
 
+    // messages are handled by the pool, the channel only starts to accept them
     void handle_messages() override {
-        // assert(handler_ != default_handler);
-        ctx_.run();
+        is_running_ = true;
+        asio::post(strand_, [this] { arm(); });
     }
 
     void stop() override {
         this->is_stopped_ = true;
-        ctx_guard_.reset();
-        ctx_.stop();
+        this->is_stopped_.notify_all();
     }
 
     void close() override {
@@ -203,84 +286,181 @@ public:
             stop();
         }
 
-        while (size_ > 0) {
-            ctx_.restart();
-            ctx_.run();
-        }
+        wheel_.clear();
+        size_ = 0;
     }
 
     void set_timer(uint32_t timeout, std::function<void()> handler) override {
-        using namespace asio;
-        steady_timer* timer = new steady_timer(ctx_);
-        timer->expires_after(std::chrono::microseconds(timeout));
-        timer->async_wait([timer, handler = std::move(handler)] (const boost::system::error_code&) {
-            delete timer;
-            handler();
-        });
+        schedule(timeout, Message(), std::move(handler));
     }
 
     void set_invasion_data(bool invasion, uint32_t nodes_cnt) override {
-        invasion_ = invasion;
-        nodes_cnt_ = nodes_cnt;
+        invasion_.set_data(invasion, nodes_cnt);
+    }
+
+    void run(std::function<void()> start) override {
+        is_running_ = true;
+        asio::post(strand_, [this, start = std::move(start)]() {
+            start();
+            handle_messages();
+        });
+    }
+
+    // waits for stop() of the running channel
+    void join() override {
+        if (is_running_) {
+            is_stopped_.wait(false);
+        }
+    }
+
+    uint64_t now() override {
+        return steady_now();
     }
 
 private:
-    std::chrono::microseconds get_delay() {
-        static std::mt19937 gen = std::mt19937(std::random_device()());
-        static auto rand_engine = std::uniform_int_distribution<>(
-            AVG_DELAY - AVG_DELAY / 2, 
-            AVG_DELAY + AVG_DELAY / 2
-        );
-        return std::chrono::microseconds(rand_engine(gen));
+    void schedule(uint64_t delay, Message msg, std::function<void()> action = nullptr) {
+        // timer is re-armed only in the strand
+        if (wheel_.add(now(), delay, std::move(msg), std::move(action))) {
+            asio::post(strand_, [this] { arm(); });
+        }
     }
 
-    bool byzantine_invasion(Message msg) {
-        if (!invasion_) {
-            return false;
+    void arm() {
+        if (!is_running_ || is_stopped_) {
+            return;
         }
 
-        assert(nodes_cnt_ != 0);
-        uint32_t f = (nodes_cnt_ - 1) / 3;
-        auto from_f_to_2f = [f](uint32_t value) { return value >= f && value < 2 * f; };
-        if (!from_f_to_2f(msg.to)) {
-            return false;
+        std::optional<uint64_t> next = wheel_.arm();
+        if (!next.has_value()) {
+            return;
         }
 
-        if (msg.type == "RB_READY") {
-            if (msg.data.contains("index") && from_f_to_2f(msg.data["index"])) {
-                VLOG(5) << "EXTRACTED " << msg << std::endl;
-                extracted_msgs.push_back(msg);
-                return true;
-            }
-        } else if (msg.type == "BinConsensus_AUX") {
-            if (!from_f_to_2f(msg.from)) {
-                return false;
+        timer_.expires_at(asio::steady_timer::time_point(std::chrono::microseconds(next.value())));
+        timer_.async_wait([this] (const boost::system::error_code& error) {
+            if (!error) {
+                expire();
             }
+        });
+    }
 
-            if (!msg.data.contains("bin_con_id") || !from_f_to_2f(msg.data["bin_con_id"])) {
-                return false;
+    void expire() {
+        TimingWheel::Entry* entries = wheel_.expire(now());
+        for (TimingWheel::Entry* entry = entries; entry; entry = entry->next) {
+            if (entry->action) {
+                if (!is_stopped_) {
+                    entry->action();
+                }
+                continue;
             }
 
-            VLOG(5) << "BYZ_INVASION: got msg: " << msg.from << " " << msg.to << msg << " START TO EXTRACT" << std::endl;
-            while (!extracted_msgs.empty()) {
-                auto extracted = extracted_msgs.front();
-                extracted_msgs.pop_front();
-                boost::asio::post(ctx_,[this, extracted = std::move(extracted)] {
-                    VLOG(5) << "EXTRACTED MSG IS PROCESSED" << std::endl;
-                    handler_(extracted);
-                });
+            if (!is_stopped_) {
+                deliver(std::move(entry->msg));
             }
+            --size_;
         }
-        return false;
+        wheel_.release(entries);
+
+        arm();
+    }
+
+    void deliver(Message msg) {
+        std::deque<Message> released;
+        bool extracted = invasion_.intercept(msg, released);
+        for (Message& held : released) {
+            asio::post(strand_, [this, held = std::move(held)] {
+                VLOG(5) << "EXTRACTED MSG IS PROCESSED" << std::endl;
+                handler_(held);
+            });
+        }
+
+        if (!extracted) {
+            handler_(std::move(msg));
+        }
+    }
+
+    uint64_t get_delay() {
+        // senders are handlers of other channels, which run on different workers
+        thread_local std::mt19937 gen = std::mt19937(std::random_device()());
+        thread_local auto rand_engine = std::uniform_int_distribution<>(
+            AVG_DELAY - AVG_DELAY / 2, 
+            AVG_DELAY + AVG_DELAY / 2
+        );
+        return rand_engine(gen);
     }
 
 private:
     static const uint32_t AVG_DELAY = 10000;
-    asio::io_context ctx_;
-    asio::executor_work_guard<asio::io_context::executor_type> ctx_guard_;
+    asio::strand<asio::io_context::executor_type> strand_;
+    asio::steady_timer timer_;
+    std::atomic<bool> is_running_{false};
 
-    // invasion data
-    bool invasion_{false};
-    uint32_t nodes_cnt_{0};
-    std::deque<Message> extracted_msgs;
+    TimingWheel wheel_;
+    ByzantineInvasion invasion_;
+};
+
+//////////////////////////////////////////// VirtualChannel ///////////////////////////////////////////////
+
+class VirtualNetwork;
+
+/* channel of VirtualNetwork: deliveries and timers are events in virtual time,
+   which are handled by VirtualNetwork::run() */
+class VirtualChannel : public IChannel {
+public:
+    VirtualChannel(VirtualNetwork& net) : net_(net) {
+    }
+
+    VirtualChannel(const VirtualChannel&) = delete;
+    VirtualChannel& operator=(const VirtualChannel&) = delete;
+
+    VirtualChannel(VirtualChannel&&) = delete;
+    VirtualChannel& operator=(VirtualChannel&&) = delete;
+
+    void set_handler(std::function<void(Message)> handler) override {
+        handler_ = handler;
+    }
+
+    Sender get_sender() override {
+        return Sender(*this);
+    }
+
+    void close() override {
+        stop();
+    }
+
+    void send(Message msg) override;
+
+    std::optional<Message> receive() override {
+        return std::nullopt;
+    }
+
+    // messages are handled by VirtualNetwork::run(), the channel only starts to accept them
+    void handle_messages() override;
+
+    void stop() override;
+
+    void set_timer(uint32_t timeout, std::function<void()> handler) override;
+
+    void set_invasion_data(bool invasion, uint32_t nodes_cnt) override {
+        invasion_.set_data(invasion, nodes_cnt);
+    }
+
+    void run(std::function<void()> start) override;
+
+    // event loop is VirtualNetwork::run(), there is nothing to wait for
+    void join() override {
+    }
+
+    uint64_t now() override;
+
+    bool is_running() const {
+        return is_running_ && !is_stopped_;
+    }
+
+    // called by VirtualNetwork on delivery
+    void deliver(Message msg);
+
+private:
+    VirtualNetwork& net_;
+    bool is_running_{false};
+    ByzantineInvasion invasion_;
 };
\ No newline at end of file
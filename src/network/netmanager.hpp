@@ -9,6 +9,11 @@
 #include "channel.hpp"
 #include "network.hpp"
 
+struct NetMetrics {
+    size_t messages_sent{0};
+    size_t bytes_sent{0};   // approximate, see Message::wire_size()
+};
+
 class INetManager {
 public:
     virtual void update_nodes() = 0;
@@ -20,6 +25,12 @@ public:
     virtual void close() = 0;
     virtual void stop_receive() = 0;
     virtual void set_timer(uint32_t, std::function<void()>) = 0;
+    virtual NetMetrics get_metrics() const = 0;
+    // event loop of the node, see IChannel::run()
+    virtual void run(std::function<void()> start) = 0;
+    virtual void join() = 0;
+    // time of the network in microseconds
+    virtual uint64_t now() const = 0;
     virtual ~INetManager() = default;
 };
 
@@ -61,6 +72,7 @@ public:
 
         msg.from = id_;
         DVLOG(7) << msg.from << " --> " << msg.to << " " << msg << std::endl;
+        count_sent(msg);
         nodes_.at(msg.to).send(std::move(msg));
     }
 
@@ -74,22 +86,34 @@ public:
     }
 
     void handle_messages() override {
-        if (net_invasion_) {
-            channel_.set_invasion_data(true, nodes_.size());
-        }
+        set_invasion_data();
         channel_.handle_messages();
     }
 
+    void run(std::function<void()> start) override {
+        set_invasion_data();
+        channel_.run(std::move(start));
+    }
+
+    void join() override {
+        channel_.join();
+    }
+
+    uint64_t now() const override {
+        return channel_.now();
+    }
+
     void stop_receive() override {
         channel_.stop();
     }
 
     void broadcast(Message msg) override {
-        // to all
+        // to all, copies share the payload of msg, only header is copied
         msg.from = id_;
         for (auto& node : nodes_) {
             msg.to = node.first;
             DVLOG(7) << msg.from << " --> " << msg.to << " " << msg << std::endl;
+            count_sent(msg);
             node.second.send(msg);
         }
     }
@@ -102,10 +126,31 @@ public:
         channel_.set_timer(timeout, handler);
     }
 
+    NetMetrics get_metrics() const override {
+        return metrics_;
+    }
+
+private:
+    void set_invasion_data() {
+        if (net_invasion_) {
+            channel_.set_invasion_data(true, nodes_.size());
+        }
+    }
+
+    void count_sent(const Message& msg) {
+        // messages to itself don't leave the node
+        if (static_cast<uint32_t>(msg.to) == id_) {
+            return;
+        }
+        ++metrics_.messages_sent;
+        metrics_.bytes_sent += msg.wire_size();
+    }
+
 private:
     uint32_t id_;
     IChannel& channel_;
     INetwork& net_;
     bool net_invasion_;
     std::unordered_map<uint32_t, Sender> nodes_;
+    NetMetrics metrics_;
 };
\ No newline at end of file
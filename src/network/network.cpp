@@ -126,22 +126,165 @@ void Network::shutdown() {
 
 /////////////////////////////////////     TimerNetwork     ///////////////////////////////////////////
 
-IChannel& TimerNetwork::add_node(uint32_t node_id) {
-    node_channels_[node_id];
+TimerNetwork::TimerNetwork(size_t threads_cnt) : pool_(threads_cnt) {
+}
 
-    return node_channels_[node_id];
+TimerNetwork::~TimerNetwork() {
+    pool_.stop();
+}
+
+IChannel& TimerNetwork::add_node(uint32_t node_id) {
+    return node_channels_.try_emplace(node_id, pool_.context()).first->second;
 }
 
 std::unordered_map<uint32_t, Sender> TimerNetwork::get_nodes() {
     std::unordered_map<uint32_t, Sender> nodes;
-    for (const auto& node : node_channels_) {
-        nodes.emplace(node.first, node_channels_[node.first].get_sender());
+    for (auto& node : node_channels_) {
+        nodes.emplace(node.first, node.second.get_sender());
     }
     return nodes;
 }
 
 void TimerNetwork::shutdown() {
+    // no handler runs after the pool is stopped
+    pool_.stop();
+    for (auto& node : node_channels_) {
+        node.second.close();
+    }
+}
+
+
+/////////////////////////////////////     VirtualNetwork     ///////////////////////////////////////////
+
+VirtualNetwork::VirtualNetwork(uint64_t seed, uint64_t avg_delay) : avg_delay_(avg_delay), gen_(seed) {
+}
+
+IChannel& VirtualNetwork::add_node(uint32_t node_id) {
+    return node_channels_.try_emplace(node_id, *this).first->second;
+}
+
+std::unordered_map<uint32_t, Sender> VirtualNetwork::get_nodes() {
+    std::unordered_map<uint32_t, Sender> nodes;
+    for (auto& node : node_channels_) {
+        nodes.emplace(node.first, node.second.get_sender());
+    }
+    return nodes;
+}
+
+void VirtualNetwork::run() {
+    while (running_cnt_ > 0 && !events_.empty()) {
+        std::pop_heap(events_.begin(), events_.end(), is_later);
+        Event event = std::move(events_.back());
+        events_.pop_back();
+
+        now_ = event.time;
+        if (!event.channel->is_running()) {
+            continue;
+        }
+
+        if (event.action) {
+            event.action();
+        } else {
+            event.channel->deliver(std::move(event.msg));
+        }
+    }
+}
+
+void VirtualNetwork::shutdown() {
     for (auto& node : node_channels_) {
         node.second.close();
     }
-}
\ No newline at end of file
+    events_.clear();
+}
+
+uint64_t VirtualNetwork::now() const {
+    return now_;
+}
+
+void VirtualNetwork::set_fault(Fault fault) {
+    fault_ = std::move(fault);
+}
+
+std::optional<uint64_t> VirtualNetwork::get_delay(const Message& msg) {
+    // delay is drawn for every message, so faults don't shift delays of the others
+    std::uniform_int_distribution<uint64_t> rand_delay(avg_delay_ - avg_delay_ / 2, avg_delay_ + avg_delay_ / 2);
+    uint64_t delay = rand_delay(gen_);
+    if (!fault_) {
+        return delay;
+    }
+
+    std::optional<uint64_t> extra = fault_(msg);
+    if (!extra.has_value()) {
+        return std::nullopt;
+    }
+    return delay + extra.value();
+}
+
+void VirtualNetwork::schedule(VirtualChannel* channel, uint64_t delay, Message msg, std::function<void()> action) {
+    events_.push_back({now_ + delay, seq_++, channel, std::move(msg), std::move(action)});
+    std::push_heap(events_.begin(), events_.end(), is_later);
+}
+
+void VirtualNetwork::on_run() {
+    ++running_cnt_;
+}
+
+void VirtualNetwork::on_stop() {
+    assert(running_cnt_ > 0);
+    --running_cnt_;
+}
+
+
+/////////////////////////////////////     VirtualChannel     ///////////////////////////////////////////
+
+void VirtualChannel::send(Message msg) {
+    if (is_stopped_) {
+        return;
+    }
+
+    std::optional<uint64_t> delay = net_.get_delay(msg);
+    if (delay.has_value()) {
+        net_.schedule(this, delay.value(), std::move(msg));
+    }
+}
+
+void VirtualChannel::deliver(Message msg) {
+    std::deque<Message> released;
+    bool extracted = invasion_.intercept(msg, released);
+    for (Message& held : released) {
+        net_.schedule(this, 0, Message(), [this, held = std::move(held)] {
+            handler_(held);
+        });
+    }
+
+    if (!extracted) {
+        handler_(std::move(msg));
+    }
+}
+
+void VirtualChannel::handle_messages() {
+    if (!is_running_ && !is_stopped_) {
+        is_running_ = true;
+        net_.on_run();
+    }
+}
+
+void VirtualChannel::stop() {
+    if (is_running()) {
+        net_.on_stop();
+    }
+    is_stopped_ = true;
+}
+
+void VirtualChannel::set_timer(uint32_t timeout, std::function<void()> handler) {
+    net_.schedule(this, timeout, Message(), std::move(handler));
+}
+
+void VirtualChannel::run(std::function<void()> start) {
+    handle_messages();
+    net_.schedule(this, 0, Message(), std::move(start));
+}
+
+uint64_t VirtualChannel::now() {
+    return net_.now();
+}
@@ -1,11 +1,15 @@
 #pragma once
 
+#include <functional>
+#include <optional>
+#include <random>
 #include <thread>
 #include <vector>
 #include <unordered_map>
 
 #include "../core/message.hpp"
 #include "channel.hpp"
+#include "worker_pool.hpp"
 
 class INetwork { // add run()
 public:
@@ -49,12 +53,70 @@ private:
 };
 
 
+// nodes are run by the fixed pool of workers instead of a thread per node
 class TimerNetwork : public INetwork {
 public:
+    TimerNetwork(size_t threads_cnt = std::thread::hardware_concurrency());
+    ~TimerNetwork() override;
     IChannel& add_node(uint32_t node_id) override;
     std::unordered_map<uint32_t, Sender> get_nodes() override;
     void shutdown();
 
 private:
+    WorkerPool pool_; // outlives the channels, their timers use its context
     std::unordered_map<uint32_t, TimerChannel> node_channels_;
-};
\ No newline at end of file
+};
+
+
+/* discrete-event simulation of TimerNetwork: one virtual clock (in microseconds),
+   deliveries of messages and timers of all nodes are events of one priority queue.
+   Events are handled by run() in the calling thread, so a run is determined by seed and node ids.
+   Usage: sim.run(); net.run(); sim.join(); net.shutdown(); */
+class VirtualNetwork : public INetwork {
+public:
+    // delays of messages are uniform in [avg_delay / 2, 3 * avg_delay / 2] microseconds
+    VirtualNetwork(uint64_t seed = std::random_device{}(), uint64_t avg_delay = AVG_DELAY);
+    IChannel& add_node(uint32_t node_id) override;
+    std::unordered_map<uint32_t, Sender> get_nodes() override;
+    // handles events until all running nodes are stopped or there are no events
+    void run();
+    void shutdown();
+
+    // faults of tests: returns extra delay of msg in microseconds, std::nullopt loses msg
+    using Fault = std::function<std::optional<uint64_t>(const Message& msg)>;
+    void set_fault(Fault fault);
+
+    uint64_t now() const;
+    // delay of the next message, std::nullopt if the message is lost
+    std::optional<uint64_t> get_delay(const Message& msg);
+    // action == nullptr means delivery of msg
+    void schedule(VirtualChannel* channel, uint64_t delay, Message msg, std::function<void()> action = nullptr);
+
+    void on_run();
+    void on_stop();
+
+private:
+    struct Event {
+        uint64_t time;
+        uint64_t seq; // events with equal time are handled in order of scheduling
+        VirtualChannel* channel;
+        Message msg;
+        std::function<void()> action;
+    };
+
+    static bool is_later(const Event& lhs, const Event& rhs) {
+        return lhs.time != rhs.time ? lhs.time > rhs.time : lhs.seq > rhs.seq;
+    }
+
+private:
+    static const uint32_t AVG_DELAY = 10000;
+
+    uint64_t avg_delay_;
+    uint64_t now_{0};
+    uint64_t seq_{0};
+    std::vector<Event> events_; // min-heap by (time, seq)
+    size_t running_cnt_{0};
+    std::mt19937_64 gen_;
+    Fault fault_;
+    std::unordered_map<uint32_t, VirtualChannel> node_channels_;
+};
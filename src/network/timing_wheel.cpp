@@ -0,0 +1,159 @@
+#include "timing_wheel.hpp"
+
+#include <algorithm>
+
+void TimingWheel::Slot::push(Entry* entry) {
+    entry->next = nullptr;
+    if (tail) {
+        tail->next = entry;
+    } else {
+        head = entry;
+    }
+    tail = entry;
+}
+
+TimingWheel::TimingWheel(uint64_t now) : current_(now / TICK) {
+}
+
+bool TimingWheel::add(uint64_t now, uint64_t delay, Message msg, std::function<void()> action) {
+    std::lock_guard lock(mutex_);
+    Entry* entry = allocate();
+    entry->deadline = std::max(current_, (now + delay + TICK - 1) / TICK);
+    entry->msg = std::move(msg);
+    entry->action = std::move(action);
+    insert(entry);
+    ++size_;
+
+    if (entry->deadline < armed_) {
+        armed_ = entry->deadline;
+        return true;
+    }
+    return false;
+}
+
+TimingWheel::Entry* TimingWheel::expire(uint64_t now) {
+    std::lock_guard lock(mutex_);
+    uint64_t target = now / TICK;
+    Slot expired;
+
+    while (current_ <= target && size_ > 0) {
+        if (current_ % SLOTS == 0) {
+            cascade();
+        }
+
+        Slot& slot = level0_[current_ % SLOTS];
+        for (Entry* entry = slot.head; entry; entry = entry->next) {
+            --size_;
+        }
+        if (slot.head) {
+            if (expired.tail) {
+                expired.tail->next = slot.head;
+            } else {
+                expired.head = slot.head;
+            }
+            expired.tail = slot.tail;
+        }
+        slot = Slot();
+        ++current_;
+    }
+
+    if (size_ == 0) {
+        current_ = std::max(current_, target + 1);
+    }
+    return expired.head;
+}
+
+void TimingWheel::release(Entry* entries) {
+    for (Entry* entry = entries; entry; entry = entry->next) {
+        entry->msg.data = std::monostate(); // drops the payload, the header is overwritten by add()
+        entry->action = nullptr;
+    }
+
+    std::lock_guard lock(mutex_);
+    free_list(entries);
+}
+
+std::optional<uint64_t> TimingWheel::arm() {
+    std::lock_guard lock(mutex_);
+    if (size_ == 0) {
+        armed_ = UINT64_MAX;
+        return std::nullopt;
+    }
+
+    // far entries are in level 1 only, then the wheel is armed to the end of level 0
+    uint64_t next = current_ + SLOTS;
+    for (uint64_t tick = current_; tick < current_ + SLOTS; ++tick) {
+        if (level0_[tick % SLOTS].head || (tick % SLOTS == 0 && level1_[tick / SLOTS % SLOTS].head)) {
+            next = tick;
+            break;
+        }
+    }
+
+    armed_ = next;
+    return next * TICK;
+}
+
+void TimingWheel::clear() {
+    std::lock_guard lock(mutex_);
+    for (Slot* level : {level0_, level1_}) {
+        for (size_t i = 0; i < SLOTS; ++i) {
+            for (Entry* entry = level[i].head; entry; entry = entry->next) {
+                entry->msg.data = std::monostate();
+                entry->action = nullptr;
+            }
+            free_list(level[i].head);
+            level[i] = Slot();
+        }
+    }
+    size_ = 0;
+}
+
+size_t TimingWheel::size() const {
+    std::lock_guard lock(mutex_);
+    return size_;
+}
+
+TimingWheel::Entry* TimingWheel::allocate() {
+    if (!free_) {
+        chunks_.push_back(std::make_unique<Entry[]>(CHUNK));
+        Entry* chunk = chunks_.back().get();
+        for (size_t i = 0; i + 1 < CHUNK; ++i) {
+            chunk[i].next = &chunk[i + 1];
+        }
+        free_ = chunk;
+    }
+
+    Entry* entry = free_;
+    free_ = entry->next;
+    return entry;
+}
+
+void TimingWheel::free_list(Entry* entries) {
+    while (entries) {
+        Entry* next = entries->next;
+        entries->next = free_;
+        free_ = entries;
+        entries = next;
+    }
+}
+
+void TimingWheel::insert(Entry* entry) {
+    if (entry->deadline - current_ < SLOTS) {
+        level0_[entry->deadline % SLOTS].push(entry);
+    } else {
+        level1_[entry->deadline / SLOTS % SLOTS].push(entry);
+    }
+}
+
+void TimingWheel::cascade() {
+    Slot& slot = level1_[current_ / SLOTS % SLOTS];
+    Entry* entries = slot.head;
+    slot = Slot();
+
+    // entries of the next turns of level 1 return to the same slot
+    while (entries) {
+        Entry* next = entries->next;
+        insert(entries);
+        entries = next;
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "../core/message.hpp"
+
+/* hierarchical timing wheel of deliveries and timers of one channel:
+   level 0 has a slot per tick, level 1 has a slot per SLOTS ticks and is cascaded into level 0.
+   Entries are pooled, add() is thread-safe, expiry is done by the owner of the wheel in batches */
+class TimingWheel {
+public:
+    struct Entry {
+        uint64_t deadline{0};           // in ticks
+        Message msg;
+        std::function<void()> action;   // timer, if set, otherwise delivery of msg
+        Entry* next{nullptr};
+    };
+
+    static const uint64_t TICK = 100;   // microseconds
+    static const uint64_t SLOTS = 256;
+
+    TimingWheel(uint64_t now);
+
+    TimingWheel(const TimingWheel&) = delete;
+    TimingWheel& operator=(const TimingWheel&) = delete;
+
+    // returns true if the entry expires before the armed deadline, so the wheel should be re-armed
+    bool add(uint64_t now, uint64_t delay, Message msg, std::function<void()> action = nullptr);
+    // list of entries, which are expired by now, in order of deadlines
+    Entry* expire(uint64_t now);
+    // returns expired entries to the pool
+    void release(Entry* entries);
+    // time of the next expiry in microseconds, nullopt if the wheel is empty
+    std::optional<uint64_t> arm();
+    void clear();
+    size_t size() const;
+
+private:
+    struct Slot {
+        Entry* head{nullptr};
+        Entry* tail{nullptr};
+
+        void push(Entry* entry);
+    };
+
+    Entry* allocate();
+    void free_list(Entry* entries);
+    void insert(Entry* entry);
+    void cascade();
+
+private:
+    static const uint64_t CHUNK = 1024;
+
+    mutable std::mutex mutex_;
+    uint64_t current_;              // next tick to expire
+    uint64_t armed_{UINT64_MAX};    // tick, at which the owner will call expire()
+    size_t size_{0};
+    Slot level0_[SLOTS];
+    Slot level1_[SLOTS];
+
+    Entry* free_{nullptr};
+    std::vector<std::unique_ptr<Entry[]>> chunks_;
+};
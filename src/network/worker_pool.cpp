@@ -0,0 +1,28 @@
+#include "worker_pool.hpp"
+
+#include <algorithm>
+
+WorkerPool::WorkerPool(size_t threads_cnt)
+    : ctx_(std::max<size_t>(threads_cnt, 1)), ctx_guard_(boost::asio::make_work_guard(ctx_)) {
+    // hardware_concurrency() is 0 if it is unknown
+    threads_cnt = std::max<size_t>(threads_cnt, 1);
+    for (size_t i = 0; i < threads_cnt; ++i) {
+        workers_.emplace_back([this] {
+            ctx_.run();
+        });
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    stop();
+}
+
+void WorkerPool::stop() {
+    ctx_guard_.reset();
+    ctx_.stop();
+    for (std::thread& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <thread>
+#include <utility>
+#include <vector>
+#include <boost/asio.hpp>
+
+/* fixed set of threads, which run handlers of all channels of a network.
+   Each channel serializes its handlers by a strand, so a node is still single-threaded,
+   but nodes are not bound to threads: any idle worker takes the next ready handler */
+class WorkerPool {
+public:
+    WorkerPool(size_t threads_cnt = std::thread::hardware_concurrency());
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    boost::asio::io_context& context() {
+        return ctx_;
+    }
+
+    size_t size() const {
+        return workers_.size();
+    }
+
+    // drops pending handlers and joins workers
+    void stop();
+
+private:
+    boost::asio::io_context ctx_;
+    boost::asio::executor_work_guard<boost::asio::io_context::executor_type> ctx_guard_;
+    std::vector<std::thread> workers_;
+};
@@ -2,67 +2,146 @@
 
 void Node::run() {
     net_manager_->update_nodes();
-    std::thread thread([this]() {
-        if (sim_data_.role == FailStop) {
-            return;
-        }
-
-        auto startTime = std::chrono::system_clock::now();
+    if (sim_data_.partition) {
+        uint32_t nodes_cnt = net_manager_->get_nodes_cnt();
+        pool_.set_partition(id_, {nodes_cnt, (nodes_cnt - 1) / 3 + 1});
+    }
 
-        DBFTs_.insert({
-            0,
-            DBFT(0, 
-                    net_manager_->get_nodes_cnt(), 
-                    sim_data_.batch_size, 
-                    *net_manager_, 
-                    pool_,
-                    sim_data_.role)
-        });
+    if (sim_data_.role == FailStop) {
+        return;
+    }
 
-        if (is_fair()) {
-            net_manager_->handle_messages();
-        }
+    if (!is_fair()) {
+        // byzantine node only sends its messages of the first window of blocks
+        start();
+        return;
+    }
 
-        auto endTime = std::chrono::system_clock::now();
-        runtime_ = std::chrono::duration<double>(endTime - startTime).count();
+    net_manager_->run([this]() {
+        start();
     });
+}
 
-    msg_processor_ = std::move(thread);
+void Node::start() {
+    start_time_ = net_manager_->now();
+    for (size_t block_id = 0; block_id < sim_data_.window && block_id < sim_data_.max_blocks; ++block_id) {
+        add_dbft(block_id, sim_data_.role);
+    }
+}
+
+void Node::add_dbft(size_t block_id, Role role) {
+    pool_.release(net_manager_->now() - start_time_);
+    DBFTOptions options = {
+        .role = role,
+        .rb_mode = sim_data_.rb_mode,
+        .coalesce = sim_data_.coalesce,
+        .decide_msgs = sim_data_.decide_msgs,
+        .phases = &phases_,
+    };
+    uint32_t batch_size = batch_controller_.get(pool_.size());
+    DBFTs_.insert({
+        block_id,
+        DBFT(block_id, net_manager_->get_nodes_cnt(), batch_size, *net_manager_, pool_, coord_timeout_, *coin_, options)
+    });
 }
 
 void Node::handle_message(Message msg) {
-    if (!msg.data.contains("block_id")) {
+    if (msg.type == MessageType::Undefined) {
         return;
     }
 
-    size_t block_id = msg.data["block_id"];
+    size_t block_id = msg.block_id;
     if (block_id < chain_.get_height()) {
+        if (msg.type == MessageType::RB_FETCH) {
+            answer_fetch(msg);
+        }
+        return;
+    }
+
+    if (block_id >= sim_data_.max_blocks) {
         return;
     }
 
     if (DBFTs_.find(block_id) == DBFTs_.end()) {
-        DBFTs_.insert({
-            block_id,
-            DBFT(block_id, net_manager_->get_nodes_cnt(), sim_data_.batch_size, *net_manager_, pool_)
-        });
+        add_dbft(block_id, Fair);
+    }
+
+    if (DBFTs_.at(block_id).process_msg(std::move(msg))) {
+        commit_decided();
+    }
+}
+
+void Node::return_uncommitted(const Block& block, const std::vector<Transaction>& proposal) {
+    for (Transaction tx : block.data) {
+        uncommitted_.erase(tx);
+    }
+
+    std::vector<Transaction> rejected;
+    for (Transaction tx : proposal) {
+        if (chain_.conflicts(tx)) {
+            ++tx_metrics_.committed;
+        } else {
+            rejected.push_back(tx);
+            uncommitted_.insert(tx);
+        }
     }
 
-    if (DBFTs_.at(block_id).process_msg(msg)) {
-        Block new_block = DBFTs_.at(block_id).get_block(chain_);
-        metrics_ = DBFTs_.at(block_id).get_metrics();
-        chain_.add_block(new_block);
-        // DLOG(INFO) << id_ << " BLOCK #" << block_id << ": " << new_block << std::endl;
+    tx_metrics_.proposed += proposal.size();
+    tx_metrics_.returned += rejected.size();
+    pool_.return_tx(rejected);
+}
+
+void Node::answer_fetch(const Message& msg) {
+    size_t age = chain_.get_height() - 1 - msg.block_id;   // 0 for the last committed block
+    if (age >= payloads_.size() || msg.index >= payloads_[payloads_.size() - 1 - age].size()) {
+        return;
+    }
+
+    // the fetching node checks the payload against the digest of its instance
+    const Message& data = payloads_[payloads_.size() - 1 - age][msg.index];
+    if (!data.has_proposal()) {
+        return;
+    }
+
+    Message payload(MessageType::RB_PAYLOAD, data);
+    payload.to = msg.from;
+    net_manager_->send(std::move(payload));
+}
+
+void Node::commit_decided() {
+    // blocks of the window are decided in any order, but are added to the chain in order
+    size_t height = chain_.get_height();
+    while (DBFTs_.contains(height) && DBFTs_.at(height).is_decided()) {
+        // assembly takes cpu time, which isn't seen by the virtual clock
+        uint64_t assembly_start = steady_now();
+        Block new_block = DBFTs_.at(height).get_block(chain_);
+        phases_.assembly.record(steady_now() - assembly_start);
+        new_block.block_id = height;
+        metrics_ = DBFTs_.at(height).get_metrics();
+        block_latencies_.push_back(metrics_.latency);
+        chain_.add_block(new_block, net_manager_->now() - start_time_);
+        phases_.commit.record(net_manager_->now() - DBFTs_.at(height).get_start_time());
+        pool_.commit(new_block.data);
+        return_uncommitted(new_block, DBFTs_.at(height).get_proposal());
+        batch_controller_.add_sample(metrics_.latency * 1e6, pool_.size());
+        // messages of committed blocks are dropped by height of the chain, except RB_FETCH of the recent ones
+        payloads_.push_back(DBFTs_.at(height).get_payloads());
+        if (payloads_.size() > PAYLOADS_HEIGHTS) {
+            payloads_.pop_front();
+        }
+        DBFTs_.erase(height);
+        // DLOG(INFO) << id_ << " BLOCK #" << height << ": " << new_block << std::endl;
 
         if (chain_.get_height() >= sim_data_.max_blocks) {
+            runtime_ = (net_manager_->now() - start_time_) / 1e6;
             net_manager_->stop_receive();
             return;
         }
 
-        if (!DBFTs_.contains(block_id + 1)) {
-            DBFTs_.insert({
-                block_id + 1,
-                DBFT(block_id + 1, net_manager_->get_nodes_cnt(), sim_data_.batch_size, *net_manager_, pool_)
-            });
+        size_t next_block_id = height + sim_data_.window;
+        if (next_block_id < sim_data_.max_blocks && !DBFTs_.contains(next_block_id)) {
+            add_dbft(next_block_id, Fair);
         }
+        height = chain_.get_height();
     }
-}
\ No newline at end of file
+}
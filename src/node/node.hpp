@@ -2,7 +2,9 @@
 #include <glog/logging.h>
 
 #include <deque>
+#include <memory>
 #include <optional>
+#include <unordered_set>
 
 #include "../core/message.hpp"
 #include "../network/netmanager.hpp"
@@ -15,15 +17,22 @@ public:
     virtual void run() = 0;
     virtual void join() = 0;
     virtual void add_tx(Transaction tx) = 0;
+    virtual void add_txs(std::vector<Transaction> txs) = 0;
+    // before run(), times are since the start of the node
+    virtual void schedule_txs(std::vector<Arrival> arrivals) = 0;
+    virtual uint32_t get_id() const = 0;
     virtual ~INode() = default;
 };
 
 
 class Node : public INode {
 public:
-    Node(uint32_t id, INetwork& net, SimulationData sim_data) : id_(id), sim_data_(sim_data) {
+    Node(uint32_t id, INetwork& net, SimulationData sim_data)
+        : id_(id), sim_data_(sim_data), coord_timeout_(sim_data.timeout_policy),
+          batch_controller_(sim_data.batch_policy, sim_data.batch_size),
+          coin_(make_coin(sim_data.coin, sim_data.coin_seed)) {
         auto handler = [this](Message msg) {
-            this->handle_message(msg);
+            this->handle_message(std::move(msg));
         };
 
         net_manager_ = new NetManager(id, net.add_node(id), net, handler, sim_data.net_invasion);
@@ -33,8 +42,17 @@ public:
 
     void handle_message(Message msg);
 
+    // thread-safe, transactions can be submitted while the node runs
     void add_tx(Transaction tx) override {
-        pool_.add_tx(tx);
+        pool_.submit(tx);
+    }
+
+    void add_txs(std::vector<Transaction> txs) override {
+        pool_.submit(std::move(txs));
+    }
+
+    void schedule_txs(std::vector<Arrival> arrivals) override {
+        pool_.schedule(std::move(arrivals));
     }
 
     Chain& get_chain() {
@@ -42,10 +60,10 @@ public:
     }
 
     void join() override {
-        msg_processor_.join();
+        net_manager_->join();
     }
 
-    uint32_t get_id() const {
+    uint32_t get_id() const override {
         return id_;
     }
 
@@ -61,6 +79,34 @@ public:
         return metrics_;
     }
 
+    TxMetrics get_tx_metrics() {
+        TxMetrics metrics = tx_metrics_;
+        metrics.lost = uncommitted_.size();
+        return metrics;
+    }
+
+    const std::unordered_set<Transaction>& get_uncommitted() const {
+        return uncommitted_;
+    }
+
+    const PhaseMetrics& get_phase_metrics() const {
+        return phases_;
+    }
+
+    // from the start of the block to its decision in seconds, in order of the chain
+    const std::vector<double>& get_block_latencies() const {
+        return block_latencies_;
+    }
+
+    // batch of the next block
+    size_t get_batch_size() {
+        return batch_controller_.get(pool_.size());
+    }
+
+    NetMetrics get_net_metrics() {
+        return net_manager_->get_metrics();
+    }
+
     bool is_fair() {
         return sim_data_.role == Fair;
     }
@@ -70,16 +116,38 @@ public:
     }
 
 private:
+    // creates DBFTs of the first window of blocks
+    void start();
+    void add_dbft(size_t block_id, Role role);
+    // adds decided blocks to the chain in order of block ids
+    void commit_decided();
+    /* transactions of the proposal of the node, which aren't in the chain after the block,
+       are returned to the front of the pool and proposed in the next block */
+    void return_uncommitted(const Block& block, const std::vector<Transaction>& proposal);
+    // RB_FETCH of a committed block is answered from the payloads of the recent blocks
+    void answer_fetch(const Message& msg);
+
+private:
+    static const size_t PAYLOADS_HEIGHTS = 32;
+
     uint32_t id_;
     INetManager* net_manager_;
-    std::thread msg_processor_;
-    double runtime_;
+    uint64_t start_time_{0};
+    double runtime_{0};
 
     TransactionPool pool_;
     Chain chain_;
-    std::unordered_map<uint32_t, DBFT> DBFTs_;
-    ConsensusMetrics metrics_;
+    std::unordered_map<uint32_t, DBFT> DBFTs_; // in-flight blocks with proposals of the node
+    std::deque<std::vector<Message>> payloads_; // of the last committed blocks by proposers
+    ConsensusMetrics metrics_;    // of the last committed block
+    std::vector<double> block_latencies_;
+    PhaseMetrics phases_;   // of all blocks, recorded by DBFTs
+    TxMetrics tx_metrics_;
+    std::unordered_set<Transaction> uncommitted_; // proposed by the node, but not committed yet
     SimulationData sim_data_;
+    CoordTimeout coord_timeout_; // shared by all DBFTs of the node
+    BatchController batch_controller_;
+    std::unique_ptr<ICoin> coin_;
 };
 
 // class FailStopNode : public INode {
@@ -122,7 +190,7 @@ public:
     BinaryNode(uint32_t id, INetwork& net, Role role, uint32_t proposal = 0)
         : id_(id), role_(role), proposal_(proposal) {
         auto handler = [this](Message msg) {
-            this->handle_message(msg);
+            this->handle_message(std::move(msg));
         };
 
         net_manager_ = new NetManager(id, net.add_node(id), net, handler);
@@ -130,41 +198,41 @@ public:
 
     void run() override {
         net_manager_->update_nodes();
-        std::thread thread([this]() {
-            auto startTime = std::chrono::system_clock::now();
-
+        if (!is_fair()) {
             bin_con = new BinConsensus(net_manager_->get_nodes_cnt(), *net_manager_);
+            bin_con->execute_byzantine(role_);
+            return;
+        }
 
-            
-            if (is_fair()) {
-                bin_con->bin_propose(proposal_);
-                net_manager_->handle_messages();
-            } else {
-                bin_con->execute_byzantine(role_);
-            }
-
-            auto endTime = std::chrono::system_clock::now();
-            runtime_ = std::chrono::duration<double>(endTime - startTime).count();
+        net_manager_->run([this]() {
+            start_time_ = net_manager_->now();
+            bin_con = new BinConsensus(net_manager_->get_nodes_cnt(), *net_manager_);
+            bin_con->bin_propose(proposal_);
         });
-
-        msg_processor_ = std::move(thread);
     }
 
     void handle_message(Message msg) {
         if (bin_con->process_msg(msg)) {
             metrics_ = bin_con->get_metrics();
+            runtime_ = (net_manager_->now() - start_time_) / 1e6;
             net_manager_->stop_receive();
         }
     }
 
     void join() override {
-        msg_processor_.join();
+        net_manager_->join();
     }
 
     void add_tx(Transaction) override {
     }
 
-    uint32_t get_id() const {
+    void add_txs(std::vector<Transaction>) override {
+    }
+
+    void schedule_txs(std::vector<Arrival>) override {
+    }
+
+    uint32_t get_id() const override {
         return id_;
     }
 
@@ -192,7 +260,7 @@ public:
 private:
     uint32_t id_;
     INetManager* net_manager_;
-    std::thread msg_processor_;
+    uint64_t start_time_{0};
 
     double runtime_{0};
     BinConsensusMetrics metrics_;
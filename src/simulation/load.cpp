@@ -0,0 +1,24 @@
+#include "load.hpp"
+
+#include <cassert>
+
+
+LoadGenerator::LoadGenerator(LoadConfig config)
+    : config_(config), gen_(config.seed), gap_(config.rate > 0 ? config.rate / 1e6 : 1) {
+    assert(config_.pattern == LoadPattern::Preloaded || config_.rate > 0);
+}
+
+uint64_t LoadGenerator::next() {
+    uint64_t arrival = time_;
+    switch (config_.pattern) {
+        case LoadPattern::Preloaded:
+            return 0;
+        case LoadPattern::Constant:
+            time_ += 1e6 / config_.rate;
+            break;
+        default:
+            time_ += gap_(gen_);
+            break;
+    }
+    return arrival;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+
+enum class LoadPattern {
+    Preloaded,  // all transactions are in the pools before the start
+    Constant,   // arrivals with equal gaps
+    Poisson,    // exponential gaps
+};
+
+inline const char* to_string(LoadPattern pattern) {
+    switch (pattern) {
+        case LoadPattern::Preloaded: return "Preloaded";
+        case LoadPattern::Constant:  return "Constant";
+        default:                     return "Poisson";
+    }
+}
+
+struct LoadConfig {
+    LoadPattern pattern{LoadPattern::Preloaded};
+    double rate{0};     // offered load in transactions per second
+    uint64_t seed{0};   // of Poisson arrivals
+};
+
+/* open-loop load: arrival times of transactions don't depend on commits,
+   so the offered load stays the same when the system saturates.
+   Times are in microseconds since the start of the nodes */
+class LoadGenerator {
+public:
+    explicit LoadGenerator(LoadConfig config);
+
+    // arrival time of the next transaction
+    uint64_t next();
+
+private:
+    LoadConfig config_;
+    double time_{0};
+    std::mt19937_64 gen_;
+    std::exponential_distribution<double> gap_;
+};
@@ -0,0 +1,59 @@
+#include "monitor.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <sys/resource.h>
+#include <unistd.h>
+
+ResourceMonitor::~ResourceMonitor() {
+    if (is_running_) {
+        stop();
+    }
+}
+
+void ResourceMonitor::start() {
+    is_running_ = true;
+    peak_rss_ = get_current_rss();
+    start_cpu_time_ = get_process_cpu_time();
+
+    sampler_ = std::thread([this]() {
+        while (is_running_) {
+            size_t rss = get_current_rss();
+            if (rss > peak_rss_) {
+                peak_rss_ = rss;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(SAMPLE_PERIOD_MS));
+        }
+    });
+}
+
+void ResourceMonitor::stop() {
+    is_running_ = false;
+    if (sampler_.joinable()) {
+        sampler_.join();
+    }
+    cpu_time_ = get_process_cpu_time() - start_cpu_time_;
+}
+
+double ResourceMonitor::get_cpu_time() const {
+    return cpu_time_;
+}
+
+size_t ResourceMonitor::get_peak_rss() const {
+    return peak_rss_;
+}
+
+double ResourceMonitor::get_process_cpu_time() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    auto to_sec = [](timeval time) { return time.tv_sec + time.tv_usec / 1e6; };
+    return to_sec(usage.ru_utime) + to_sec(usage.ru_stime);
+}
+
+size_t ResourceMonitor::get_current_rss() {
+    // second field of statm is resident set size in pages
+    std::ifstream statm("/proc/self/statm");
+    size_t size = 0, resident = 0;
+    statm >> size >> resident;
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+
+/* samples resources of the whole process while simulation runs:
+   cpu time and peak resident memory */
+class ResourceMonitor {
+public:
+    ResourceMonitor() = default;
+
+    ResourceMonitor(const ResourceMonitor&) = delete;
+    ResourceMonitor& operator=(const ResourceMonitor&) = delete;
+
+    ~ResourceMonitor();
+
+    void start();
+    void stop();
+
+    // seconds of user + system time between start() and stop()
+    double get_cpu_time() const;
+    // max resident set size (KB) observed between start() and stop()
+    size_t get_peak_rss() const;
+
+private:
+    static double get_process_cpu_time();
+    static size_t get_current_rss();
+
+private:
+    static const size_t SAMPLE_PERIOD_MS = 5;
+
+    std::thread sampler_;
+    std::atomic<bool> is_running_{false};
+    std::atomic<size_t> peak_rss_{0};
+    double start_cpu_time_{0};
+    double cpu_time_{0};
+};
@@ -1,14 +1,30 @@
 #include "simulation.hpp"
 #include "structs.hpp"
 
+#include <algorithm>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 
+namespace {
+
+// of sorted values, 0 if there are no values
+template <typename T>
+T get_quantile(const std::vector<T>& values, double quantile) {
+    if (values.empty()) {
+        return 0;
+    }
+
+    size_t rank = std::min(values.size() - 1, static_cast<size_t>(quantile * values.size()));
+    return values[rank];
+}
+
+} // namespace
 
 Simulation::Simulation(INetwork& net, SimulationConfig& config) : net_(net), config_(config) {
     assert(config_.fail * 3 < config_.nodes);
     generate_nodes();
-    generate_tx();
+    generate_tx(config_.tx_cnt);
 }
 
 Simulation::~Simulation() {
@@ -20,6 +36,7 @@ Simulation::~Simulation() {
 void Simulation::run() {
     assert(!nodes_.empty());
 
+    monitor_.start();
     for (size_t i = 0; i < nodes_.size(); ++i) {
         nodes_[i]->run();
     }
@@ -29,6 +46,7 @@ void Simulation::join() {
     for (size_t i = 0; i < nodes_.size(); ++i) {
         nodes_[i]->join();
     }
+    monitor_.stop();
 }
 
 std::vector<INode*>& Simulation::get_nodes() {
@@ -60,7 +78,48 @@ void Simulation::write_results(std::ofstream& file, size_t run_id) {
          << get_runtime() << ","
          << config_.sim_data.batch_size << ","
          << get_rounds_number() << ","
-         << get_block_size() << "\n";
+         << get_block_size() << ","
+         << monitor_.get_cpu_time() << ","
+         << monitor_.get_peak_rss() << ","
+         << to_string(config_.sim_data.rb_mode) << ","
+         << get_net_metrics().messages_sent << ","
+         << get_net_metrics().bytes_sent << ","
+         << config_.sim_data.window << ","
+         << get_throughput() << ","
+         << config_.sim_data.coalesce << ","
+         << to_string(config_.sim_data.timeout_policy) << ","
+         << get_round_latency() << ","
+         << get_timeout_hit_rate() << ","
+         << to_string(config_.sim_data.coin) << ","
+         << config_.sim_data.decide_msgs << ","
+         << get_rounds_after_decision() << ","
+         << config_.sim_data.partition << ","
+         << get_tx_per_block() << ","
+         << get_tx_throughput() << ","
+         << get_fair_node()->get_chain().get_tx_cnt() << ","
+         << get_lost_tx() << ","
+         << to_string(config_.sim_data.batch_policy) << ","
+         << get_fair_node()->get_batch_size() << ","
+         << to_string(config_.load.pattern) << ","
+         << config_.load.rate << ","
+         << get_commit_latency(0.5) << ","
+         << get_commit_latency(0.9) << ","
+         << get_commit_latency(0.99) << ","
+         << get_commit_latency(0.999) << ","
+         << get_uncommitted_arrivals() << ","
+         << config_.warmup_blocks << ","
+         << get_steady_throughput() << ","
+         << get_steady_tx_throughput() << ","
+         << get_block_latency(0.5) << ","
+         << get_block_latency(0.9) << ","
+         << get_block_latency(0.99);
+
+    const PhaseMetrics& phases = get_phase_metrics();
+    for (const LatencyHistogram* phase : {&phases.rb_delivery, &phases.quorum, &phases.round, &phases.bin_decision,
+                                          &phases.decision, &phases.assembly, &phases.commit}) {
+        file << "," << phase->get_quantile(0.5) / 1e6 << "," << phase->get_quantile(0.99) / 1e6;
+    }
+    file << "\n";
     file.flush();
 }
 
@@ -89,22 +148,49 @@ void Simulation::generate_nodes() {
 void Simulation::generate_tx(size_t cnt) {
     assert(!nodes_.empty());
 
+    // replicas are chosen by ids, so nodes can find their slots, see TxPartition
+    std::vector<INode*> nodes_by_id(nodes_.size());
+    for (INode* node : nodes_) {
+        nodes_by_id[node->get_id()] = node;
+    }
+
+    TxPartition partition{static_cast<uint32_t>(nodes_.size()), static_cast<uint32_t>(get_max_failed() + 1)};
+    LoadGenerator load(config_.load);
+    std::vector<std::vector<Arrival>> node_txs(nodes_.size());
     for (size_t i = 0; i < cnt; ++i) {
         Transaction new_tx = gen_tx();
         generated_tx_.push_back(new_tx);
 
-        size_t node_id = std::hash<Transaction>{}(new_tx) % nodes_.size();
+        uint64_t arrival = load.next();
+        arrivals_.try_emplace(new_tx, arrival);
+
+        size_t node_id = partition.get_home(new_tx);
 
-        for (size_t j = 0; j <= get_max_failed(); ++j) {
-            nodes_[node_id]->add_tx(new_tx);
+        for (size_t j = 0; j < partition.replicas_cnt; ++j) {
+            node_txs[node_id].push_back({arrival, new_tx});
             node_id = (node_id + 1) % nodes_.size();
         }
     }
+
+    // one submission per node
+    for (size_t node_id = 0; node_id < nodes_.size(); ++node_id) {
+        if (config_.load.pattern != LoadPattern::Preloaded) {
+            nodes_by_id[node_id]->schedule_txs(std::move(node_txs[node_id]));
+            continue;
+        }
+
+        std::vector<Transaction> txs;
+        txs.reserve(node_txs[node_id].size());
+        for (const Arrival& arrival : node_txs[node_id]) {
+            txs.push_back(arrival.tx);
+        }
+        nodes_by_id[node_id]->add_txs(std::move(txs));
+    }
 }
 
 double Simulation::get_runtime() {
     double runtime_sum = 0;
-    for (size_t i = 1; i < config_.nodes; ++i) {
+    for (size_t i = 0; i < config_.nodes; ++i) {
         Node* node = dynamic_cast<Node*>(nodes_[i]);
         if (!node || !node->is_fair()) {
             continue;
@@ -116,6 +202,127 @@ double Simulation::get_runtime() {
     return runtime_sum / (config_.nodes - config_.fail);
 }
 
+double Simulation::get_throughput() {
+    return config_.sim_data.max_blocks / get_runtime();
+}
+
+double Simulation::get_tx_per_block() {
+    Chain& chain = get_fair_node()->get_chain();
+    return static_cast<double>(chain.get_tx_cnt()) / chain.get_height();
+}
+
+double Simulation::get_tx_throughput() {
+    return get_fair_node()->get_chain().get_tx_cnt() / get_runtime();
+}
+
+size_t Simulation::get_lost_tx() {
+    std::unordered_set<Transaction> lost;
+    for (INode* inode : nodes_) {
+        Node* node = dynamic_cast<Node*>(inode);
+        if (!node || !node->is_fair()) {
+            continue;
+        }
+
+        lost.insert(node->get_uncommitted().begin(), node->get_uncommitted().end());
+    }
+
+    return lost.size();
+}
+
+void Simulation::set_commit_latencies() {
+    if (has_commit_latencies_) {
+        return;
+    }
+    has_commit_latencies_ = true;
+
+    Chain& chain = get_fair_node()->get_chain();
+    std::unordered_set<Transaction> committed;
+    uint64_t end = 0;
+    for (size_t i = 0; i < chain.get_height(); ++i) {
+        Block& block = chain.get_block(i);
+        end = std::max(end, block.commit_time);
+        for (Transaction tx : block.data) {
+            uint64_t* arrival = arrivals_.find(tx);
+            if (!arrival || !committed.insert(tx).second) {
+                continue;
+            }
+
+            // replicas run on their own clocks in real time networks
+            commit_latencies_.push_back(block.commit_time > *arrival ? block.commit_time - *arrival : 0);
+        }
+    }
+    std::sort(commit_latencies_.begin(), commit_latencies_.end());
+
+    // latencies of these transactions are censored by the end of the run
+    std::unordered_set<Transaction> uncommitted;
+    for (Transaction tx : generated_tx_) {
+        if (*arrivals_.find(tx) <= end && !committed.contains(tx)) {
+            uncommitted.insert(tx);
+        }
+    }
+    uncommitted_arrivals_ = uncommitted.size();
+}
+
+double Simulation::get_commit_latency(double quantile) {
+    set_commit_latencies();
+    return get_quantile(commit_latencies_, quantile) / 1e6;
+}
+
+size_t Simulation::get_uncommitted_arrivals() {
+    set_commit_latencies();
+    return uncommitted_arrivals_;
+}
+
+double Simulation::get_steady_throughput() {
+    Chain& chain = get_fair_node()->get_chain();
+    size_t warmup = config_.warmup_blocks;
+    assert(warmup < chain.get_height());
+
+    uint64_t start = warmup == 0 ? 0 : chain.get_block(warmup - 1).commit_time;
+    uint64_t end = chain.get_block(chain.get_height() - 1).commit_time;
+    return end == start ? 0 : (chain.get_height() - warmup) / ((end - start) / 1e6);
+}
+
+double Simulation::get_steady_tx_throughput() {
+    Chain& chain = get_fair_node()->get_chain();
+    size_t warmup = config_.warmup_blocks;
+    assert(warmup < chain.get_height());
+
+    // transactions of the chain don't repeat, blocks are assembled without committed ones
+    size_t tx_cnt = 0;
+    for (size_t i = warmup; i < chain.get_height(); ++i) {
+        tx_cnt += chain.get_block(i).size();
+    }
+
+    double blocks_per_sec = get_steady_throughput();
+    return blocks_per_sec == 0 ? 0 : tx_cnt / ((chain.get_height() - warmup) / blocks_per_sec);
+}
+
+double Simulation::get_block_latency(double quantile) {
+    if (block_latencies_.empty()) {
+        const std::vector<double>& latencies = get_fair_node()->get_block_latencies();
+        assert(config_.warmup_blocks < latencies.size());
+        block_latencies_.assign(latencies.begin() + config_.warmup_blocks, latencies.end());
+        std::sort(block_latencies_.begin(), block_latencies_.end());
+    }
+
+    return get_quantile(block_latencies_, quantile);
+}
+
+const PhaseMetrics& Simulation::get_phase_metrics() {
+    if (!has_phases_) {
+        for (INode* inode : nodes_) {
+            Node* node = dynamic_cast<Node*>(inode);
+            if (node && node->is_fair()) {
+                phases_.add(node->get_phase_metrics());
+            }
+        }
+        has_phases_ = true;
+    }
+
+    return phases_;
+}
+
 size_t Simulation::get_block_size() {
     Node* node = get_fair_node();
     return node->get_metrics().block_size;
@@ -126,6 +333,39 @@ size_t Simulation::get_rounds_number() {
     return node->get_metrics().rounds_number;
 }
 
+double Simulation::get_round_latency() {
+    Node* node = get_fair_node();
+    return node->get_metrics().round_latency;
+}
+
+double Simulation::get_timeout_hit_rate() {
+    Node* node = get_fair_node();
+    return node->get_metrics().timeout_hit_rate;
+}
+
+double Simulation::get_rounds_after_decision() {
+    Node* node = get_fair_node();
+    return node->get_metrics().rounds_after_decision;
+}
+
+NetMetrics Simulation::get_net_metrics() {
+    NetMetrics sum;
+    size_t fair_cnt = 0;
+    for (INode* inode : nodes_) {
+        Node* node = dynamic_cast<Node*>(inode);
+        if (!node || !node->is_fair()) {
+            continue;
+        }
+
+        ++fair_cnt;
+        sum.messages_sent += node->get_net_metrics().messages_sent;
+        sum.bytes_sent += node->get_net_metrics().bytes_sent;
+    }
+
+    assert(fair_cnt != 0);
+    return {sum.messages_sent / fair_cnt, sum.bytes_sent / fair_cnt};
+}
+
 // BinarySimulation::BinarySimulation(BinarySimulationConfig& config) : config_(config) {
 //     assert(config_.fail * 3 < config_.nodes);
 //     generate_nodes();
@@ -6,6 +6,7 @@
 
 #include "../core/transaction.hpp"
 #include "../node/node.hpp"
+#include "monitor.hpp"
 
 class Simulation {
 public:
@@ -20,6 +21,22 @@ public:
 
     void write_results(std::ofstream& file, size_t run_id);
 
+    // unique transactions per second
+    double get_tx_throughput();
+    // from arrival to commit at a fair node in seconds, of committed transactions
+    double get_commit_latency(double quantile);
+    // arrived before the last block of a fair node, but not committed, so they aren't in get_commit_latency
+    size_t get_uncommitted_arrivals();
+
+    // steady state: blocks of the chain of a fair node after warmup_blocks
+    double get_steady_throughput();     // blocks per second
+    double get_steady_tx_throughput();  // transactions per second
+    // from the start of the block to its decision in seconds
+    double get_block_latency(double quantile);
+
+    // phases of the blocks of all fair nodes, aggregated on the first request after join()
+    const PhaseMetrics& get_phase_metrics();
+
 private:
     size_t get_max_failed() {
         assert(!nodes_.empty());
@@ -27,19 +44,39 @@ private:
     }
 
     void generate_nodes();
-    void generate_tx(size_t cnt = TX_CNT);
+    void generate_tx(size_t cnt);
+
+    // computes commit_latencies_ and uncommitted_arrivals_ on the first request
+    void set_commit_latencies();
 
     double get_runtime();
+    // blocks per second
+    double get_throughput();
+    // unique transactions per block of the chain
+    double get_tx_per_block();
+    // proposed by fair nodes, but not committed
+    size_t get_lost_tx();
     size_t get_block_size();
     size_t get_rounds_number();
+    double get_round_latency();
+    double get_timeout_hit_rate();
+    double get_rounds_after_decision();
+    // averaged over fair nodes
+    NetMetrics get_net_metrics();
 
 private:
-    static const size_t TX_CNT = 100000;
-
     INetwork& net_;
     SimulationConfig config_;
     std::vector<INode*> nodes_;
     std::vector<Transaction> generated_tx_;
+    FlatHashMap<Transaction, uint64_t, TxHash> arrivals_;   // tx -> arrival time
+    std::vector<uint64_t> commit_latencies_;                // sorted, computed on the first request
+    size_t uncommitted_arrivals_{0};
+    bool has_commit_latencies_{false};
+    std::vector<double> block_latencies_;                   // sorted, of the steady state
+    PhaseMetrics phases_;
+    bool has_phases_{false};
+    ResourceMonitor monitor_;
 };
 
 
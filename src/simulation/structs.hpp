@@ -2,12 +2,26 @@
 
 #include "../network/network.hpp"
 #include "../node/role.hpp"
+#include "../consensus/ReliableBroadcast.hpp"
+#include "../consensus/CoordTimeout.hpp"
+#include "../consensus/Coin.hpp"
+#include "../consensus/BatchController.hpp"
+#include "load.hpp"
 
 struct SimulationData {
     size_t max_blocks{1};
     size_t batch_size{1};
     Role role{Fair};
     bool net_invasion{false};
+    RBMode rb_mode{RBMode::Full};
+    size_t window{1};   // number of blocks, which are decided concurrently
+    bool coalesce{false}; // send messages of binary consensuses of a block in batches
+    TimeoutPolicy timeout_policy{TimeoutPolicy::Fixed}; // of the coordinator in binary consensus
+    CoinType coin{CoinType::Parity};    // of binary consensus
+    uint64_t coin_seed{0};              // shared key of CoinType::Common
+    bool decide_msgs{false};            // DECIDE messages stop binary consensus after decision
+    bool partition{false};  // replicas of a tx propose it in different blocks, see TxPartition
+    BatchPolicy batch_policy{BatchPolicy::Fixed};   // batch_size is the initial batch of Adaptive
 };
 
 struct SimulationConfig {
@@ -16,6 +30,9 @@ struct SimulationConfig {
     size_t fail;
     bool shuffle;
     SimulationData sim_data;
+    LoadConfig load{};  // arrivals of transactions at the pools of the nodes
+    size_t tx_cnt{100000};  // generated transactions
+    size_t warmup_blocks{0};    // first blocks, which are excluded from the steady state metrics
 };
 
 struct BinarySimulationConfig {
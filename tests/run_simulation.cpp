@@ -8,7 +8,13 @@
 #include <cstdlib>
 #include <memory>
 #include <fstream>
+#include <algorithm>
+#include <unordered_set>
+#include <unistd.h>
+#include <numeric>
+#include <thread>
 
+#include <../src/core/hash.hpp>
 #include <../src/core/message.hpp>
 #include <../src/network/netmanager.hpp>
 #include <../src/network/network.hpp>
@@ -34,6 +40,21 @@ void run_simulation(SimulationConfig& config, std::ofstream& file, size_t run_id
     sim.write_results(file, run_id);
 }
 
+// runtime is measured in virtual time of VirtualNetwork
+void run_virtual_simulation(SimulationConfig& config, std::ofstream& file, size_t run_id, uint64_t avg_delay = 10000) {
+    VirtualNetwork net(std::random_device{}(), avg_delay);
+
+    Simulation sim(net, config);
+
+    sim.run();
+    net.run();
+    sim.join();
+
+    net.shutdown();
+
+    sim.write_results(file, run_id);
+}
+
 TEST(DBFT, Simulation) {
     std::ofstream result_file("../tests/test_results/Ok_result.csv", std::ios::out);
 
@@ -56,21 +77,99 @@ TEST(DBFT, SimulationBatch) {
     std::ofstream result_file("../tests/test_results/Batch_result.csv", std::ios::out);
 
     size_t n = 16;
-    for (size_t batch : {1, 10, 20, 50, 100, 200, 500, 1000}) {
+    for (RBMode rb_mode : {RBMode::Full, RBMode::Digest}) {
+        for (size_t batch : {1, 10, 20, 50, 100, 200, 500, 1000}) {
+            SimulationConfig config = {
+                "Batch",
+                n,
+                0,
+                true,
+                {1, batch, Fair, false, rb_mode}
+            };
+
+            for (size_t i = 0; i < 20; ++i) {
+                run_simulation(config, result_file, i);
+            }
+        }
+    }
+}
+
+TEST(DBFT, BroadcastEgress) {
+    std::ofstream result_file("../tests/test_results/Egress_result.csv", std::ios::out);
+
+    size_t n = 16;
+    for (RBMode rb_mode : {RBMode::Full, RBMode::Digest, RBMode::Erasure}) {
+        for (size_t batch : {1, 10, 20, 50, 100, 200, 500, 1000}) {
+            SimulationConfig config = {
+                "Egress",
+                n,
+                0,
+                true,
+                {1, batch, Fair, false, rb_mode}
+            };
+
+            for (size_t i = 0; i < 5; ++i) {
+                run_simulation(config, result_file, i);
+            }
+        }
+    }
+}
+
+// nodes of TimerNetwork share the pool of hardware_concurrency() workers
+TEST(DBFT, LargeNetwork) {
+    std::ofstream result_file("../tests/test_results/Large_result.csv", std::ios::out);
+
+    for (size_t n : {100, 250, 500, 1000}) {
+        SimulationConfig config = {
+            "Large",
+            n,
+            0,
+            true,
+            {1, 10, Fair}
+        };
+
+        for (size_t i = 0; i < 3; ++i) {
+            run_simulation(config, result_file, i);
+        }
+    }
+}
+
+TEST(DBFT, Pipelined) {
+    std::ofstream result_file("../tests/test_results/Pipelined_result.csv", std::ios::out);
+
+    size_t n = 16;
+    for (size_t window : {1, 2, 4, 8, 16}) {
         SimulationConfig config = {
-            "Batch",
+            "Pipelined",
             n,
             0,
             true,
-            {1, batch, Fair}
+            {20, 10, Fair, false, RBMode::Full, window}
         };
 
-        for (size_t i = 0; i < 20; ++i) {
+        for (size_t i = 0; i < 5; ++i) {
             run_simulation(config, result_file, i);
         }
     }
 }
 
+// peak rss should not grow with the number of blocks, since committed instances are reclaimed
+TEST(DBFT, Soak) {
+    std::ofstream result_file("../tests/test_results/Soak_result.csv", std::ios::out);
+
+    for (size_t max_blocks : {1000, 2500, 5000, 10000}) {
+        SimulationConfig config = {
+            "Soak",
+            4,
+            0,
+            true,
+            {max_blocks, 1, Fair, false, RBMode::Full, 4}
+        };
+
+        run_virtual_simulation(config, result_file, 0);
+    }
+}
+
 TEST(DBFT, FailStop) {
     for (size_t n = 4; n <= 31; n += 3) {
         SimulationConfig config = {
@@ -105,20 +204,566 @@ TEST(DBFT, Rejectors) {
 
 TEST(DBFT, BinConCrashers) {
     for (size_t n = 4; n <= 31; n += 3) {
+        for (CoinType coin : {CoinType::Parity, CoinType::Common}) {
+            SimulationConfig config = {
+                "BinConCrasher",
+                n,
+                (n - 1) / 3,
+                false,
+                {1, 10, BinConCrasher, true, RBMode::Full, 1, false, TimeoutPolicy::Fixed, coin}
+            };
+
+            for (size_t i = 0; i < 20; ++i) {
+                config.sim_data.coin_seed = i;
+                run_simulation(config, result_fail, i);
+            }
+        }
+    }
+}
+
+TEST(DBFT, VirtualSimulation) {
+    std::ofstream result_file("../tests/test_results/Virtual_result.csv", std::ios::out);
+
+    std::vector<std::pair<std::string, Role>> sim_types = {
+        {"FailStop", FailStop}, {"Rejector", TxRejector}, {"BinConCrasher", BinConCrasher}
+    };
+
+    for (size_t n = 4; n <= 103; n += 3) {
+        for (auto& [sim_type, role] : sim_types) {
+            SimulationConfig config = {
+                sim_type,
+                n,
+                (n - 1) / 3,
+                role == FailStop,
+                {1, 10, role, role != FailStop}
+            };
+
+            for (size_t i = 0; i < 20; ++i) {
+                run_virtual_simulation(config, result_file, i);
+            }
+        }
+    }
+}
+
+// messages of binary consensuses sent one by one vs in batches per block
+TEST(DBFT, Coalescing) {
+    std::ofstream result_file("../tests/test_results/Coalesce_result.csv", std::ios::out);
+
+    std::vector<std::pair<std::string, Role>> sim_types = {
+        {"FailStop", FailStop}, {"Rejector", TxRejector}
+    };
+
+    for (size_t n = 4; n <= 64; n += 6) {
+        for (auto& [sim_type, role] : sim_types) {
+            for (bool coalesce : {false, true}) {
+                SimulationConfig config = {
+                    sim_type,
+                    n,
+                    (n - 1) / 3,
+                    role == FailStop,
+                    {1, 10, role, role != FailStop, RBMode::Full, 1, coalesce}
+                };
+
+                for (size_t i = 0; i < 5; ++i) {
+                    run_virtual_simulation(config, result_file, i);
+                }
+            }
+        }
+    }
+}
+
+// fixed vs adaptive timeout of the coordinator on networks with different delays
+TEST(DBFT, CoordTimeout) {
+    std::ofstream result_file("../tests/test_results/Timeout_result.csv", std::ios::out);
+
+    std::vector<std::pair<std::string, Role>> sim_types = {
+        {"FailStop", FailStop}, {"Rejector", TxRejector}
+    };
+
+    for (uint64_t avg_delay : {1000, 10000, 50000}) {
+        for (size_t n = 4; n <= 31; n += 9) {
+            for (auto& [sim_type, role] : sim_types) {
+                for (TimeoutPolicy policy : {TimeoutPolicy::Fixed, TimeoutPolicy::Adaptive}) {
+                    SimulationConfig config = {
+                        sim_type + "_" + std::to_string(avg_delay),
+                        n,
+                        (n - 1) / 3,
+                        role == FailStop,
+                        {5, 10, role, false, RBMode::Full, 1, false, policy}
+                    };
+
+                    for (size_t i = 0; i < 5; ++i) {
+                        run_virtual_simulation(config, result_file, i, avg_delay);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// binary consensus stopped by DECIDE messages vs by extra rounds after decision
+TEST(DBFT, DecideMessages) {
+    std::ofstream result_file("../tests/test_results/Decide_result.csv", std::ios::out);
+
+    std::vector<std::pair<std::string, Role>> sim_types = {
+        {"FailStop", FailStop}, {"Rejector", TxRejector}, {"BinConCrasher", BinConCrasher}
+    };
+
+    for (size_t n = 4; n <= 64; n += 6) {
+        for (auto& [sim_type, role] : sim_types) {
+            for (bool decide_msgs : {false, true}) {
+                SimulationConfig config = {
+                    sim_type,
+                    n,
+                    (n - 1) / 3,
+                    role == FailStop,
+                    {1, 10, role, role != FailStop, RBMode::Full, 1, false,
+                     TimeoutPolicy::Fixed, CoinType::Parity, 0, decide_msgs}
+                };
+
+                for (size_t i = 0; i < 5; ++i) {
+                    run_virtual_simulation(config, result_file, i);
+                }
+            }
+        }
+    }
+}
+
+// replicas of a tx propose it in the same block vs in blocks of their slots
+TEST(DBFT, Partition) {
+    std::ofstream result_file("../tests/test_results/Partition_result.csv", std::ios::out);
+
+    std::vector<std::pair<std::string, Role>> sim_types = {
+        {"Ok", Fair}, {"FailStop", FailStop}, {"Rejector", TxRejector}
+    };
+
+    for (size_t n = 4; n <= 64; n += 6) {
+        for (auto& [sim_type, role] : sim_types) {
+            for (bool partition : {false, true}) {
+                SimulationConfig config = {
+                    sim_type,
+                    n,
+                    role == Fair ? 0 : (n - 1) / 3,
+                    role == FailStop,
+                    {5, 10, role, false, RBMode::Full, 1, false,
+                     TimeoutPolicy::Fixed, CoinType::Parity, 0, false, partition}
+                };
+
+                for (size_t i = 0; i < 5; ++i) {
+                    run_virtual_simulation(config, result_file, i);
+                }
+            }
+        }
+    }
+}
+
+// fixed vs adaptive batch size, starting from a small batch
+TEST(DBFT, AdaptiveBatch) {
+    std::ofstream result_file("../tests/test_results/AdaptiveBatch_result.csv", std::ios::out);
+
+    std::vector<std::pair<std::string, Role>> sim_types = {
+        {"Ok", Fair}, {"FailStop", FailStop}
+    };
+
+    for (size_t n = 4; n <= 31; n += 9) {
+        for (auto& [sim_type, role] : sim_types) {
+            for (BatchPolicy policy : {BatchPolicy::Fixed, BatchPolicy::Adaptive}) {
+                SimulationConfig config = {
+                    sim_type,
+                    n,
+                    role == Fair ? 0 : (n - 1) / 3,
+                    role == FailStop,
+                    {20, 10, role, false, RBMode::Full, 1, false,
+                     TimeoutPolicy::Fixed, CoinType::Parity, 0, false, false, policy}
+                };
+
+                for (size_t i = 0; i < 5; ++i) {
+                    run_simulation(config, result_file, i);
+                }
+            }
+        }
+    }
+}
+
+// open-loop Poisson load: latency from arrival to commit and the saturation point as the offered load grows
+TEST(DBFT, OpenLoop) {
+    std::ofstream result_file("../tests/test_results/OpenLoop_result.csv", std::ios::out);
+
+    for (size_t n = 4; n <= 16; n += 12) {
+        /* lowest offered load, at which the committed load grows less than half as much as the offered one.
+           Transactions, which arrive in the last blocks, aren't committed at any load,
+           so the committed load is compared between steps rather than with the offered load */
+        double saturation = 0;
+        double prev_rate = 0;
+        double prev_tx_throughput = 0;
+        for (double rate = 250; rate <= 64000 && saturation == 0; rate *= 2) {
+            SimulationConfig config = {
+                "Ok",
+                n,
+                0,
+                false,
+                {30, 100, Fair, false, RBMode::Full, 2, false,
+                 TimeoutPolicy::Fixed, CoinType::Parity, 0, false, true, BatchPolicy::Adaptive},
+                {LoadPattern::Poisson, rate, 0}
+            };
+
+            double tx_throughput = 0;
+            double uncommitted = 0;
+            for (size_t i = 0; i < 3; ++i) {
+                config.load.seed = i;
+                VirtualNetwork net(i);
+                Simulation sim(net, config);
+
+                sim.run();
+                net.run();
+                sim.join();
+
+                net.shutdown();
+
+                sim.write_results(result_file, i);
+                tx_throughput += sim.get_tx_throughput() / 3;
+                uncommitted += sim.get_uncommitted_arrivals() / 3.0;
+            }
+
+            std::cout << n << " nodes, offered " << rate << " tx/sec: committed " << tx_throughput << " tx/sec, "
+                      << uncommitted << " arrived transactions uncommitted\n";
+            if (prev_rate != 0 && tx_throughput - prev_tx_throughput < (rate - prev_rate) / 2) {
+                saturation = rate;
+            }
+            prev_rate = rate;
+            prev_tx_throughput = tx_throughput;
+        }
+
+        std::cout << n << " nodes: saturation at " << saturation << " tx/sec\n";
+    }
+}
+
+// thousands of blocks: steady state after warm-up vs the whole run, which includes the start of the nodes
+TEST(DBFT, Sustained) {
+    std::ofstream result_file("../tests/test_results/Sustained_result.csv", std::ios::out);
+
+    for (size_t n = 4; n <= 16; n += 6) {
         SimulationConfig config = {
-            "BinConCrasher",
+            "Ok",
             n,
-            (n - 1) / 3,
+            0,
             false,
-            {1, 10, BinConCrasher, true}
+            {2000, 100, Fair, false, RBMode::Full, 4, false,
+             TimeoutPolicy::Fixed, CoinType::Parity, 0, false, true, BatchPolicy::Adaptive},
+            {}, 200000, 200
         };
 
-        for (size_t i = 0; i < 20; ++i) {
-            run_simulation(config, result_fail, i);
+        for (size_t i = 0; i < 3; ++i) {
+            run_simulation(config, result_file, i);
+        }
+    }
+}
+
+// where the latency of blocks goes: medians of the phases over the blocks of all fair nodes
+TEST(DBFT, Phases) {
+    std::ofstream result_file("../tests/test_results/Phases_result.csv", std::ios::out);
+
+    std::vector<std::pair<std::string, Role>> sim_types = {
+        {"Ok", Fair}, {"FailStop", FailStop}
+    };
+
+    for (size_t n = 4; n <= 31; n += 9) {
+        for (auto& [sim_type, role] : sim_types) {
+            SimulationConfig config = {
+                sim_type,
+                n,
+                role == Fair ? 0 : (n - 1) / 3,
+                role == FailStop,
+                {20, 100, role, false, RBMode::Full, 1, false,
+                 TimeoutPolicy::Fixed, CoinType::Parity, 0, false, true}
+            };
+
+            VirtualNetwork net(n);
+            Simulation sim(net, config);
+
+            sim.run();
+            net.run();
+            sim.join();
+
+            net.shutdown();
+
+            sim.write_results(result_file, 0);
+
+            const PhaseMetrics& phases = sim.get_phase_metrics();
+            std::cout << n << " nodes, " << sim_type << ", p50 ms: rb_delivery "
+                      << phases.rb_delivery.get_quantile(0.5) / 1e3
+                      << ", quorum " << phases.quorum.get_quantile(0.5) / 1e3
+                      << ", round " << phases.round.get_quantile(0.5) / 1e3
+                      << ", bin_decision " << phases.bin_decision.get_quantile(0.5) / 1e3
+                      << ", decision " << phases.decision.get_quantile(0.5) / 1e3
+                      << ", assembly " << phases.assembly.get_quantile(0.5) / 1e3
+                      << ", commit " << phases.commit.get_quantile(0.5) / 1e3 << "\n";
         }
     }
 }
 
+// assembly of a block from n = 16 decided proposals: linear scan of the block vs ConflictIndex
+TEST(DBFT, BlockAssembly) {
+    std::ofstream result_file("../tests/test_results/Assembly_result.csv", std::ios::out);
+    result_file << "keys,batch,block_size,scan_us,index_us" << std::endl;
+
+    // mod 73 keys of the imitation and keys, which never conflict, so blocks keep all transactions
+    std::vector<std::pair<std::string, ConflictIndex::KeyFunction>> keys = {
+        {"mod73", conflict_key}, {"unique", [](Transaction tx) -> uint64_t { return tx; }}
+    };
+
+    const size_t n = 16;
+    const size_t runs = 10;
+    for (auto& [keys_name, key] : keys) {
+        for (size_t batch : {1, 10, 20, 50, 100, 200, 500, 1000}) {
+            std::vector<std::vector<Transaction>> proposals(n);
+            for (auto& proposal : proposals) {
+                for (size_t i = 0; i < batch; ++i) {
+                    proposal.push_back(gen_tx());
+                }
+            }
+
+            size_t block_size = 0;
+            uint64_t start_time = steady_now();
+            for (size_t run = 0; run < runs; ++run) {
+                std::vector<Transaction> block;
+                for (auto& proposal : proposals) {
+                    for (Transaction tx : proposal) {
+                        bool conflicts = std::any_of(block.begin(), block.end(), [&](Transaction other) {
+                            return other == tx || key(other) == key(tx);
+                        });
+                        if (!conflicts) {
+                            block.push_back(tx);
+                        }
+                    }
+                }
+                block_size = block.size();
+            }
+            double scan_time = (steady_now() - start_time) / static_cast<double>(runs);
+
+            start_time = steady_now();
+            for (size_t run = 0; run < runs; ++run) {
+                std::vector<Transaction> block;
+                ConflictIndex index(key);
+                for (auto& proposal : proposals) {
+                    for (Transaction tx : proposal) {
+                        if (!index.conflicts(tx)) {
+                            index.add(tx);
+                            block.push_back(tx);
+                        }
+                    }
+                }
+                EXPECT_EQ(block.size(), block_size);
+            }
+            double index_time = (steady_now() - start_time) / static_cast<double>(runs);
+
+            std::cout << keys_name << " batch " << batch << ": block of " << block_size << " tx, scan "
+                      << scan_time << " us, index " << index_time << " us" << std::endl;
+            result_file << keys_name << "," << batch << "," << block_size << ","
+                        << scan_time << "," << index_time << std::endl;
+        }
+    }
+}
+
+// resident memory of the process in KB
+size_t current_rss() {
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0;
+    size_t resident = 0;
+    statm >> pages >> resident;
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+// committed transactions of a long run: CommittedIndex vs unordered_set, as Chain had before
+TEST(Chain, CommittedIndex) {
+    std::ofstream result_file("../tests/test_results/CommittedIndex_result.csv", std::ios::out);
+    result_file << "index,committed,insert_sec,hit_ns,miss_ns,rss_kb" << std::endl;
+
+    const size_t block_size = 1000;
+    const size_t lookups_cnt = 1000000;
+    // distinct transactions in random order, mix64 is a bijection
+    auto tx_at = [](uint64_t i) -> Transaction {
+        return mix64(i);
+    };
+
+    auto measure = [&](const std::string& name, size_t committed_cnt, auto& index, auto&& insert, auto&& wait) {
+        size_t rss = current_rss();
+        uint64_t start_time = steady_now();
+        std::vector<Transaction> block;
+        for (size_t i = 0; i < committed_cnt; ++i) {
+            block.push_back(tx_at(i));
+            if (block.size() == block_size) {
+                insert(block);
+                block.clear();
+            }
+        }
+        wait();
+        double insert_time = (steady_now() - start_time) / 1e6;
+        rss = current_rss() - rss;
+
+        size_t found = 0;
+        start_time = steady_now();
+        for (size_t i = 0; i < lookups_cnt; ++i) {
+            found += index.contains(tx_at(i * (committed_cnt / lookups_cnt)));
+        }
+        double hit_ns = (steady_now() - start_time) * 1e3 / lookups_cnt;
+
+        start_time = steady_now();
+        for (size_t i = 0; i < lookups_cnt; ++i) {
+            found += index.contains(tx_at(committed_cnt + i));
+        }
+        double miss_ns = (steady_now() - start_time) * 1e3 / lookups_cnt;
+        EXPECT_EQ(found, lookups_cnt);
+
+        std::cout << name << " " << committed_cnt << " tx: insert " << insert_time << " sec, hit "
+                  << hit_ns << " ns, miss " << miss_ns << " ns, rss +" << rss << " KB" << std::endl;
+        result_file << name << "," << committed_cnt << "," << insert_time << "," << hit_ns << ","
+                    << miss_ns << "," << rss << std::endl;
+    };
+
+    for (size_t committed_cnt : {1000000, 10000000, 20000000}) {
+        {
+            CommittedIndex index;
+            measure("committed_index", committed_cnt, index,
+                    [&](const std::vector<Transaction>& block) { index.insert(block); },
+                    [&] { index.wait_compaction(); });
+            std::cout << "runs: " << index.get_runs_cnt() << ", bytes per tx: "
+                      << static_cast<double>(index.memory()) / index.size() << std::endl;
+        }
+        {
+            std::unordered_set<Transaction> index;
+            measure("unordered_set", committed_cnt, index,
+                    [&](const std::vector<Transaction>& block) { index.insert(block.begin(), block.end()); },
+                    [] {});
+        }
+    }
+}
+
+// transactions per second submitted by producer threads, while the node takes batches
+TEST(TransactionPool, Submission) {
+    std::ofstream result_file("../tests/test_results/Submission_result.csv", std::ios::out);
+    result_file << "producers,batch,tx_per_sec" << std::endl;
+
+    const size_t tx_cnt = 1000000;
+    for (size_t batch : {1, 100}) {
+        for (size_t producers_cnt : {1, 2, 4, 8, 16}) {
+            TransactionPool pool;
+            size_t per_producer = tx_cnt / producers_cnt / batch * batch;
+            uint64_t start_time = steady_now();
+
+            std::vector<std::thread> producers;
+            for (size_t i = 0; i < producers_cnt; ++i) {
+                producers.emplace_back([&pool, i, batch, per_producer] {
+                    Transaction first = i * per_producer + 1;
+                    for (Transaction tx = first; tx < first + per_producer; tx += batch) {
+                        std::vector<Transaction> txs(batch);
+                        std::iota(txs.begin(), txs.end(), tx);
+                        pool.submit(std::move(txs));
+                    }
+                });
+            }
+
+            size_t taken = 0;
+            while (taken < per_producer * producers_cnt) {
+                taken += pool.take(1000).size();
+            }
+            for (auto& producer : producers) {
+                producer.join();
+            }
+
+            double rate = taken / ((steady_now() - start_time) / 1e6);
+            std::cout << producers_cnt << " producers, batch " << batch << ": " << rate << " tx/sec" << std::endl;
+            result_file << producers_cnt << "," << batch << "," << rate << std::endl;
+        }
+    }
+}
+
+// delivery through a steady_timer per message, as TimerChannel did before the timing wheel
+class AsioTimerChannel {
+public:
+    AsioTimerChannel(std::function<void(Message)> handler)
+        : ctx_(1), ctx_guard_(asio::make_work_guard(ctx_)), handler_(std::move(handler)) {
+        loop_ = std::thread([this] { ctx_.run(); });
+    }
+
+    void send(Message msg) {
+        // called by several sender threads
+        thread_local std::mt19937 gen(std::random_device{}());
+        thread_local std::uniform_int_distribution<> rand_delay(5000, 15000);
+
+        asio::steady_timer* timer = new asio::steady_timer(ctx_);
+        timer->expires_after(std::chrono::microseconds(rand_delay(gen)));
+        timer->async_wait([this, timer, msg = std::move(msg)] (const boost::system::error_code&) {
+            delete timer;
+            handler_(msg);
+        });
+    }
+
+    void stop() {
+        ctx_guard_.reset();
+        ctx_.stop();
+        loop_.join();
+    }
+
+private:
+    asio::io_context ctx_;
+    asio::executor_work_guard<asio::io_context::executor_type> ctx_guard_;
+    std::function<void(Message)> handler_;
+    std::thread loop_;
+};
+
+// messages per second from 4 sending threads to one channel, until all messages are handled
+TEST(TimerChannel, Throughput) {
+    std::ofstream result_file("../tests/test_results/Channel_result.csv", std::ios::out);
+    result_file << "channel,messages,msgs_per_sec" << std::endl;
+
+    const size_t senders_cnt = 4;
+    auto measure = [senders_cnt](size_t msgs_cnt, auto&& send, auto&& start, std::atomic<size_t>& handled) {
+        uint64_t start_time = steady_now();
+        start();
+        std::vector<std::thread> senders;
+        for (size_t i = 0; i < senders_cnt; ++i) {
+            senders.emplace_back([&send, msgs_cnt, senders_cnt, i] {
+                Message msg(MessageType::BV);
+                msg.from = i;
+                for (size_t j = 0; j < msgs_cnt / senders_cnt; ++j) {
+                    msg.round = j;
+                    send(msg);
+                }
+            });
+        }
+        for (auto& sender : senders) {
+            sender.join();
+        }
+        while (handled < msgs_cnt / senders_cnt * senders_cnt) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return (msgs_cnt / senders_cnt * senders_cnt) / ((steady_now() - start_time) / 1e6);
+    };
+
+    for (size_t msgs_cnt : {10000, 100000, 1000000}) {
+        std::atomic<size_t> handled{0};
+        AsioTimerChannel asio_channel([&handled](Message) { ++handled; });
+        double asio_rate = measure(msgs_cnt, [&](Message msg) { asio_channel.send(std::move(msg)); }, [] {}, handled);
+        asio_channel.stop();
+
+        handled = 0;
+        WorkerPool pool(1);
+        TimerChannel channel(pool.context());
+        channel.set_handler([&handled](Message) { ++handled; });
+        double wheel_rate = measure(msgs_cnt, [&](Message msg) { channel.send(std::move(msg)); },
+                                    [&] { channel.run([] {}); }, handled);
+        channel.stop();
+        pool.stop();
+        channel.close();
+
+        std::cout << msgs_cnt << " messages: steady_timer " << asio_rate << " msgs/sec, timing wheel "
+                  << wheel_rate << " msgs/sec" << std::endl;
+        result_file << "steady_timer," << msgs_cnt << "," << asio_rate << std::endl;
+        result_file << "timing_wheel," << msgs_cnt << "," << wheel_rate << std::endl;
+    }
+}
+
 // TEST(DBFT, TxRejectors) {
 //     size_t n = 16;
 //     for (size_t f = 0; f <= (n - 1) / 3; ++f) {
@@ -139,6 +139,42 @@ TEST(BinConsensus, TimerNetwork) {
     }
 }
 
+void virtual_network_check(int n, std::function<uint32_t(uint32_t)> gen_proposal) {
+    VirtualNetwork net;
+    std::vector<std::unique_ptr<BinaryNode>> nodes;
+
+    for (int i = 0; i < n; ++i) {
+        nodes.emplace_back(std::make_unique<BinaryNode>(i, net, Fair, gen_proposal(i)));
+    }
+    for (int i = 0; i < n; ++i) {
+        nodes[i]->run();
+    }
+
+    net.run();
+
+    for (int i = 0; i < n; ++i) {
+        nodes[i]->join();
+    }
+
+    net.shutdown();
+
+    for (int i = 1; i < n; ++i) {
+        EXPECT_EQ(nodes[0]->get_metrics().decision, nodes[i]->get_metrics().decision);
+    }
+}
+
+TEST(BinConsensus, VirtualNetwork) {
+    auto gen_one = [](uint32_t) { return 1;};
+    auto gen_mod = [](uint32_t id) { return id % 2;};
+    auto gen_rand = [](uint32_t) { return std::rand() % 2;};
+
+    for (int n = 4; n < 40; ++n) {
+        virtual_network_check(n, gen_one);
+        virtual_network_check(n, gen_mod);
+        virtual_network_check(n, gen_rand);
+    }
+}
+
 // void run_simulation(std::string sim_type, size_t n, size_t f, Role fail_role, size_t run_id) {
 //     TimerNetwork net;
 //     BinarySimulationConfig config = {net, sim_type, n, f, fail_role};
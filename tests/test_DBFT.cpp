@@ -8,31 +8,27 @@
 #include <cstdlib>
 #include <memory>
 #include <fstream>
+#include <algorithm>
+#include <unordered_set>
+#include <random>
+#include <numeric>
+#include <thread>
 
 #include <../src/core/message.hpp>
 #include <../src/network/netmanager.hpp>
 #include <../src/network/network.hpp>
+#include <../src/network/timing_wheel.hpp>
 #include <../src/consensus/DBFT.hpp>
 #include <../src/node/node.hpp>
 #include <../src/simulation/simulation.hpp>
 
 
-void sanity_check(size_t n, size_t f = 0, size_t batch_size = 5) {
-    TimerNetwork net;
-    SimulationConfig config = {"Ok", n, f, true, {3, batch_size}};
-
-    Simulation sim(net, config);
-
-    sim.run();
-    sim.join();
-
-    net.shutdown();
-
+void check_chains(Simulation& sim) {
     Node* expected_node = sim.get_fair_node();
     auto nodes = sim.get_nodes(); 
-    for (size_t i = 0; i < n; ++i) {
+    for (size_t i = 0; i < nodes.size(); ++i) {
         Node* node = dynamic_cast<Node*>(nodes[i]);
-        if (!node) {
+        if (!node || !node->is_fair()) {
             continue;
         }
 
@@ -50,6 +46,51 @@ void sanity_check(size_t n, size_t f = 0, size_t batch_size = 5) {
     }
 }
 
+void sanity_check(size_t n, size_t f = 0, size_t batch_size = 5, RBMode rb_mode = RBMode::Full, size_t window = 1,
+                  bool coalesce = false, bool partition = false) {
+    TimerNetwork net;
+    SimulationConfig config = {
+        .sim_type = "Ok", .nodes = n, .fail = f, .shuffle = true,
+        .sim_data = {.max_blocks = 3, .batch_size = batch_size, .rb_mode = rb_mode, .window = window,
+                     .coalesce = coalesce, .partition = partition}
+    };
+
+    Simulation sim(net, config);
+
+    sim.run();
+    sim.join();
+
+    net.shutdown();
+
+    check_chains(sim);
+}
+
+// runs the simulation on the virtual network until all nodes stop
+std::unique_ptr<Simulation> run_virtual(VirtualNetwork& net, SimulationConfig config) {
+    auto sim = std::make_unique<Simulation>(net, config);
+
+    sim->run();
+    net.run();
+    sim->join();
+
+    net.shutdown();
+    return sim;
+}
+
+void virtual_check(size_t n, size_t f = 0, Role role = FailStop, bool coalesce = false,
+                   TimeoutPolicy timeout_policy = TimeoutPolicy::Fixed, CoinType coin = CoinType::Parity,
+                   bool decide_msgs = false) {
+    VirtualNetwork net;
+    SimulationConfig config = {
+        .sim_type = "Ok", .nodes = n, .fail = f, .shuffle = true,
+        .sim_data = {.max_blocks = 3, .batch_size = 5, .role = role, .coalesce = coalesce,
+                     .timeout_policy = timeout_policy, .coin = coin,
+                     .coin_seed = static_cast<uint64_t>(std::rand()), .decide_msgs = decide_msgs}
+    };
+
+    check_chains(*run_virtual(net, config));
+}
+
 TEST(DBFT, JustWorks) {
     for (size_t n = 4; n < 16; ++n) {
         sanity_check(n, 0);
@@ -71,6 +112,611 @@ TEST(DBFT, FailStop) {
     }
 }
 
+TEST(DBFT, DigestRB) {
+    for (size_t n = 4; n < 16; n += 3) {
+        sanity_check(n, 0, 5, RBMode::Digest);
+        sanity_check(n, (n - 1) / 3, 5, RBMode::Digest);
+    }
+}
+
+TEST(DBFT, ErasureRB) {
+    for (size_t n = 4; n < 16; n += 3) {
+        sanity_check(n, 0, 5, RBMode::Erasure);
+        sanity_check(n, (n - 1) / 3, 5, RBMode::Erasure);
+    }
+}
+
+TEST(DBFT, Pipelined) {
+    for (size_t n = 4; n < 16; n += 3) {
+        for (size_t window : {2, 3, 5}) {
+            sanity_check(n, 0, 5, RBMode::Full, window);
+            sanity_check(n, (n - 1) / 3, 5, RBMode::Full, window);
+        }
+    }
+}
+
+TEST(DBFT, FetchCommittedPayload) {
+    // proposer withholds RB_INIT from node 3, which fetches the payload of block 0 after the others commit it
+    VirtualNetwork net(42);
+    net.set_fault([](const Message& msg) -> std::optional<uint64_t> {
+        if (msg.type == MessageType::RB_INIT && msg.from == 0 && msg.to == 3) {
+            return std::nullopt;
+        }
+        if (msg.type == MessageType::RB_FETCH && msg.from == 3 && msg.block_id == 0) {
+            return 200000;
+        }
+        return 0;
+    });
+
+    SimulationConfig config = {
+        .sim_type = "Ok", .nodes = 4, .fail = 0, .shuffle = false,
+        .sim_data = {.max_blocks = 20, .batch_size = 5, .rb_mode = RBMode::Digest, .window = 3}
+    };
+    auto sim = run_virtual(net, config);
+
+    for (INode* node : sim->get_nodes()) {
+        ASSERT_EQ(dynamic_cast<Node*>(node)->get_chain().get_height(), 20);
+    }
+    check_chains(*sim);
+}
+
+TEST(DBFT, Coalescing) {
+    for (size_t n = 4; n < 16; n += 3) {
+        sanity_check(n, 0, 5, RBMode::Full, 1, true);
+        sanity_check(n, (n - 1) / 3, 5, RBMode::Full, 3, true);
+    }
+
+    for (size_t n = 4; n < 32; n += 9) {
+        virtual_check(n, (n - 1) / 3, FailStop, true);
+        virtual_check(n, (n - 1) / 3, TxRejector, true);
+        virtual_check(n, (n - 1) / 3, BinConCrasher, true);
+    }
+}
+
+TEST(DBFT, AdaptiveTimeout) {
+    for (size_t n = 4; n < 32; n += 9) {
+        virtual_check(n, 0, FailStop, false, TimeoutPolicy::Adaptive);
+        virtual_check(n, (n - 1) / 3, FailStop, false, TimeoutPolicy::Adaptive);
+        virtual_check(n, (n - 1) / 3, TxRejector, false, TimeoutPolicy::Adaptive);
+    }
+}
+
+TEST(DBFT, CommonCoin) {
+    for (size_t n = 4; n < 32; n += 9) {
+        virtual_check(n, 0, FailStop, false, TimeoutPolicy::Fixed, CoinType::Common);
+        virtual_check(n, (n - 1) / 3, FailStop, false, TimeoutPolicy::Fixed, CoinType::Common);
+        virtual_check(n, (n - 1) / 3, TxRejector, false, TimeoutPolicy::Fixed, CoinType::Common);
+        virtual_check(n, (n - 1) / 3, BinConCrasher, false, TimeoutPolicy::Fixed, CoinType::Common);
+    }
+}
+
+TEST(DBFT, DecideMessages) {
+    for (size_t n = 4; n < 32; n += 9) {
+        for (Role role : {FailStop, TxRejector, BinConCrasher}) {
+            virtual_check(n, (n - 1) / 3, role, false, TimeoutPolicy::Fixed, CoinType::Parity, true);
+            virtual_check(n, (n - 1) / 3, role, false, TimeoutPolicy::Fixed, CoinType::Common, true);
+        }
+        virtual_check(n, (n - 1) / 3, FailStop, true, TimeoutPolicy::Fixed, CoinType::Parity, true);
+    }
+}
+
+TEST(DBFT, PartitionedPool) {
+    uint32_t n = 7;
+    TxPartition partition{n, (n - 1) / 3 + 1};
+    std::vector<TransactionPool> pools(n);
+    std::vector<Transaction> txs;
+    for (Transaction tx = 1; tx <= 1000; ++tx) {
+        txs.push_back(tx);
+        for (uint32_t j = 0; j < partition.replicas_cnt; ++j) {
+            pools[(partition.get_home(tx) + j) % n].add_tx(tx);
+        }
+    }
+    for (uint32_t i = 0; i < n; ++i) {
+        pools[i].set_partition(i, partition);
+    }
+
+    // every replica proposes all its transactions in one of the blocks, and only once per block
+    for (size_t block_id = 0; block_id < partition.replicas_cnt; ++block_id) {
+        std::vector<Transaction> proposed;
+        for (TransactionPool& pool : pools) {
+            std::vector<Transaction> tx = pool.get_proposal(block_id, txs.size());
+            proposed.insert(proposed.end(), tx.begin(), tx.end());
+        }
+
+        std::sort(proposed.begin(), proposed.end());
+        EXPECT_EQ(proposed, txs);
+    }
+
+    // a replica with an empty slot proposes nothing rather than transactions of the other replicas
+    for (Transaction tx = 1; tx <= 100; ++tx) {
+        if (!partition.is_replica(tx, 0)) {
+            continue;
+        }
+
+        TransactionPool pool;
+        pool.set_partition(0, partition);
+        pool.add_tx(tx);
+        uint32_t replica = (n - partition.get_home(tx)) % n;
+        for (size_t block_id = 0; block_id < partition.replicas_cnt; ++block_id) {
+            std::vector<Transaction> expected;
+            if (partition.get_slot(tx, block_id) == replica) {
+                expected.push_back(tx);
+            }
+            EXPECT_EQ(pool.get_proposal(block_id, 10), expected);
+        }
+    }
+}
+
+TEST(DBFT, Partition) {
+    for (size_t n = 4; n < 16; n += 3) {
+        sanity_check(n, 0, 5, RBMode::Full, 1, false, true);
+        sanity_check(n, (n - 1) / 3, 5, RBMode::Full, 1, false, true);
+        sanity_check(n, (n - 1) / 3, 5, RBMode::Full, 3, false, true);
+    }
+}
+
+TEST(DBFT, ReturnUncommitted) {
+    TransactionPool pool;
+    for (Transaction tx = 1; tx <= 10; ++tx) {
+        pool.add_tx(tx);
+    }
+
+    std::vector<Transaction> proposal = pool.get_proposal(0, 5);
+    pool.return_tx(proposal);
+    EXPECT_EQ(pool.get_proposal(1, 5), proposal);
+
+    for (bool partition : {false, true}) {
+        VirtualNetwork net;
+        SimulationConfig config = {
+            .sim_type = "Ok", .nodes = 10, .fail = 3, .shuffle = true,
+            .sim_data = {.max_blocks = 5, .batch_size = 10, .role = FailStop, .partition = partition}
+        };
+        auto sim = run_virtual(net, config);
+
+        check_chains(*sim);
+        for (INode* inode : sim->get_nodes()) {
+            Node* node = dynamic_cast<Node*>(inode);
+            if (!node->is_fair()) {
+                continue;
+            }
+
+            TxMetrics metrics = node->get_tx_metrics();
+            EXPECT_EQ(metrics.proposed, metrics.committed + metrics.returned);
+            EXPECT_LE(metrics.lost, metrics.returned);
+            for (Transaction tx : node->get_uncommitted()) {
+                EXPECT_FALSE(node->get_chain().conflicts(tx));
+            }
+        }
+    }
+}
+
+TEST(DBFT, AdaptiveBatch) {
+    BatchController controller(BatchPolicy::Adaptive, 10);
+    EXPECT_EQ(controller.get(3), 3);
+    EXPECT_EQ(controller.get(0), 0);
+
+    // backlog in the pool doubles the batch, growth of latency halves it
+    controller.add_sample(10000, 1000);
+    EXPECT_EQ(controller.get(1000), 20);
+    controller.add_sample(10000, 10);
+    EXPECT_EQ(controller.get(1000), 20);
+    for (size_t i = 0; i < 10; ++i) {
+        controller.add_sample(100000, 1000);
+    }
+    EXPECT_EQ(controller.get(1000), 1);
+
+    TransactionPool pool;
+    EXPECT_TRUE(pool.get_proposal(0, 10).empty());
+
+    // nodes propose less than batch_size or nothing, when their pools run out
+    for (BatchPolicy policy : {BatchPolicy::Fixed, BatchPolicy::Adaptive}) {
+        VirtualNetwork net;
+        SimulationConfig config = {
+            .sim_type = "Ok", .nodes = 4, .fail = 1, .shuffle = true,
+            .sim_data = {.max_blocks = 3, .batch_size = 40000, .role = FailStop, .batch_policy = policy}
+        };
+
+        check_chains(*run_virtual(net, config));
+    }
+
+    for (size_t n = 4; n < 32; n += 9) {
+        VirtualNetwork net;
+        SimulationConfig config = {
+            .sim_type = "Ok", .nodes = n, .fail = (n - 1) / 3, .shuffle = true,
+            .sim_data = {.max_blocks = 5, .batch_size = 5, .role = TxRejector, .window = 2,
+                         .batch_policy = BatchPolicy::Adaptive}
+        };
+
+        check_chains(*run_virtual(net, config));
+    }
+}
+
+TEST(DBFT, OpenLoopLoad) {
+    LoadGenerator constant({LoadPattern::Constant, 1000});
+    EXPECT_EQ(constant.next(), 0);
+    EXPECT_EQ(constant.next(), 1000);
+    EXPECT_EQ(constant.next(), 2000);
+
+    // transactions aren't proposed before their arrival
+    TransactionPool pool;
+    pool.schedule({{2000, 3}, {0, 1}, {1000, 2}});
+    pool.release(500);
+    EXPECT_EQ(pool.size(), 1);
+    pool.release(2000);
+    EXPECT_EQ(pool.take(10), std::vector<Transaction>({1, 2, 3}));
+
+    for (LoadPattern pattern : {LoadPattern::Constant, LoadPattern::Poisson}) {
+        VirtualNetwork net;
+        SimulationConfig config = {
+            .sim_type = "Ok", .nodes = 7, .fail = 2, .shuffle = true,
+            .sim_data = {.max_blocks = 10, .batch_size = 50, .role = FailStop, .window = 2},
+            .load = {.pattern = pattern, .rate = 2000, .seed = 42}
+        };
+        auto sim = run_virtual(net, config);
+
+        check_chains(*sim);
+        // a tx is committed at least one message delay after its arrival
+        EXPECT_GT(sim->get_commit_latency(0), 0);
+        EXPECT_LE(sim->get_commit_latency(0.5), sim->get_commit_latency(0.99));
+        EXPECT_GT(sim->get_tx_throughput(), 0);
+    }
+}
+
+TEST(DBFT, SteadyState) {
+    VirtualNetwork net;
+    SimulationConfig config = {
+        .sim_type = "Ok", .nodes = 7, .fail = 2, .shuffle = true,
+        .sim_data = {.max_blocks = 40, .batch_size = 20, .role = FailStop, .window = 4,
+                     .partition = true, .batch_policy = BatchPolicy::Adaptive},
+        .tx_cnt = 10000, .warmup_blocks = 10
+    };
+    auto sim = run_virtual(net, config);
+
+    check_chains(*sim);
+    Node* node = sim->get_fair_node();
+    EXPECT_EQ(node->get_block_latencies().size(), node->get_chain().get_height());
+    for (size_t i = 1; i < node->get_chain().get_height(); ++i) {
+        EXPECT_LE(node->get_chain().get_block(i - 1).commit_time, node->get_chain().get_block(i).commit_time);
+    }
+
+    // preloaded transactions are either committed or censored by the end of the run (ids rarely repeat)
+    size_t arrivals_cnt = sim->get_uncommitted_arrivals() + node->get_chain().get_tx_cnt();
+    EXPECT_LE(arrivals_cnt, 10000);
+    EXPECT_GE(arrivals_cnt, 9990);
+
+    EXPECT_GT(sim->get_steady_throughput(), 0);
+    EXPECT_GT(sim->get_steady_tx_throughput(), 0);
+    EXPECT_GT(sim->get_block_latency(0.5), 0);
+    EXPECT_LE(sim->get_block_latency(0.5), sim->get_block_latency(0.99));
+}
+
+TEST(DBFT, Phases) {
+    // with DECIDE messages instances also adopt decisions of the others, which are recorded too
+    for (bool decide_msgs : {false, true}) {
+        VirtualNetwork net;
+        SimulationConfig config = {
+            .sim_type = "Ok", .nodes = 7, .fail = 2, .shuffle = true,
+            .sim_data = {.max_blocks = 10, .batch_size = 20, .role = FailStop, .window = 2,
+                         .decide_msgs = decide_msgs, .partition = true}
+        };
+        auto sim = run_virtual(net, config);
+
+        check_chains(*sim);
+        const PhaseMetrics& phases = sim->get_phase_metrics();
+        // 5 fair nodes, 10 blocks, proposals of 4 other fair nodes and 7 binary consensuses in each block
+        EXPECT_EQ(phases.decision.get_count(), 50);
+        EXPECT_EQ(phases.commit.get_count(), 50);
+        EXPECT_EQ(phases.assembly.get_count(), 50);
+        EXPECT_EQ(phases.quorum.get_count(), 50);
+        EXPECT_EQ(phases.rb_delivery.get_count(), 200);
+        EXPECT_EQ(phases.bin_decision.get_count(), 350);
+        // decided instances stop their rounds after n - f DECIDEs
+        if (!decide_msgs) {
+            EXPECT_GE(phases.round.get_count(), 350);
+        }
+
+        // phases go in order
+        EXPECT_LE(phases.rb_delivery.get_quantile(0), phases.quorum.get_quantile(0));
+        EXPECT_LE(phases.quorum.get_max(), phases.decision.get_max());
+        EXPECT_LE(phases.bin_decision.get_max(), phases.decision.get_max());
+        EXPECT_LE(phases.decision.get_quantile(0.5), phases.commit.get_quantile(0.5));
+    }
+
+    // round messages to node 6 are late, so it adopts decisions from DECIDEs of the other 5 fair nodes
+    VirtualNetwork net;
+    net.set_fault([](const Message& msg) -> std::optional<uint64_t> {
+        bool is_round_msg = msg.type == MessageType::BIN_BATCH
+                            || (is_bin_consensus(msg.type) && msg.type != MessageType::DECIDE);
+        return is_round_msg && msg.to == 6 ? 100000 : 0;
+    });
+    SimulationConfig config = {
+        .sim_type = "Ok", .nodes = 7, .fail = 1, .shuffle = false,
+        .sim_data = {.max_blocks = 10, .batch_size = 20, .role = FailStop, .window = 2, .decide_msgs = true}
+    };
+    auto sim = run_virtual(net, config);
+
+    check_chains(*sim);
+    // 6 fair nodes, 10 blocks, 7 binary consensuses in each block
+    EXPECT_EQ(sim->get_phase_metrics().bin_decision.get_count(), 420);
+}
+
+TEST(LatencyHistogram, Quantiles) {
+    LatencyHistogram histogram;
+    EXPECT_EQ(histogram.get_quantile(0.5), 0);
+
+    std::vector<uint64_t> values;
+    std::mt19937_64 gen(42);
+    for (size_t i = 0; i < 10000; ++i) {
+        values.push_back(gen() % 10000000);
+        histogram.record(values.back());
+    }
+    std::sort(values.begin(), values.end());
+
+    // relative error of the lowest value of a bucket is below 1 / 32
+    for (double quantile : {0.0, 0.5, 0.9, 0.99, 0.999}) {
+        uint64_t expected = values[quantile * values.size()];
+        EXPECT_LE(histogram.get_quantile(quantile), expected);
+        EXPECT_GE(histogram.get_quantile(quantile) * 33 / 32 + 1, expected);
+    }
+    EXPECT_EQ(histogram.get_count(), values.size());
+    EXPECT_EQ(histogram.get_max(), values.back());
+
+    // concurrent recording and merge
+    LatencyHistogram merged;
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < 4; ++i) {
+        threads.emplace_back([&merged] {
+            for (uint64_t value = 0; value < 1000; ++value) {
+                merged.record(value);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    merged.add(histogram);
+    EXPECT_EQ(merged.get_count(), 14000);
+    EXPECT_EQ(merged.get_quantile(0), 0);
+    EXPECT_EQ(merged.get_max(), values.back());
+}
+
+// the owner of the wheel expires it at armed times, returns times of expiry by index of the message
+std::vector<uint64_t> run_wheel(TimingWheel& wheel, size_t msgs_cnt) {
+    std::vector<uint64_t> expired_at(msgs_cnt, 0);
+    uint64_t last = 0;
+    while (auto next = wheel.arm()) {
+        EXPECT_GE(*next, last);
+        last = *next;
+        TimingWheel::Entry* entries = wheel.expire(*next);
+        for (TimingWheel::Entry* entry = entries; entry; entry = entry->next) {
+            EXPECT_EQ(expired_at[entry->msg.index], 0);
+            expired_at[entry->msg.index] = *next;
+            if (entry->action) {
+                entry->action();
+            }
+        }
+        wheel.release(entries);
+    }
+    return expired_at;
+}
+
+// deadlines past one revolution of level 0 go through level 1 and its cascade
+TEST(TimingWheel, FarDeadlines) {
+    const uint64_t start = 12345;
+    const uint64_t revolution = TimingWheel::SLOTS * TimingWheel::TICK;
+    TimingWheel wheel(start);
+
+    std::vector<uint64_t> deadlines; // in microseconds, by index of the message
+    auto add = [&](uint64_t now, uint64_t delay, std::function<void()> action = nullptr) {
+        Message msg;
+        msg.index = deadlines.size();
+        deadlines.push_back((now + delay + TimingWheel::TICK - 1) / TimingWheel::TICK * TimingWheel::TICK);
+        return wheel.add(now, delay, msg, std::move(action));
+    };
+
+    std::mt19937_64 gen(42);
+    EXPECT_TRUE(add(start, 3 * revolution));
+    for (size_t i = 0; i < 300; ++i) {
+        add(start, gen() % (40 * revolution));
+    }
+    // past one revolution of level 1
+    add(start, TimingWheel::SLOTS * revolution + 7 * TimingWheel::TICK);
+    add(start, 3 * TimingWheel::SLOTS * revolution);
+    // entry before the armed deadline re-arms the wheel
+    EXPECT_TRUE(add(start, TimingWheel::TICK));
+    EXPECT_FALSE(add(start, 5 * revolution));
+    EXPECT_EQ(wheel.size(), deadlines.size());
+
+    EXPECT_EQ(run_wheel(wheel, deadlines.size()), deadlines);
+    EXPECT_EQ(wheel.size(), 0);
+
+    // cleared entries don't expire, the wheel is reused after clear
+    const uint64_t now = *std::max_element(deadlines.begin(), deadlines.end()) + 10 * revolution;
+    for (size_t i = 0; i < 10; ++i) {
+        wheel.add(now, i * revolution, Message());
+    }
+    wheel.clear();
+    EXPECT_EQ(wheel.size(), 0);
+    EXPECT_EQ(wheel.arm(), std::nullopt);
+    EXPECT_EQ(wheel.expire(now), nullptr);
+
+    deadlines.clear();
+    bool fired = false;
+    add(now, 2 * revolution, [&fired] { fired = true; });
+    add(now, revolution / 2);
+    EXPECT_EQ(run_wheel(wheel, deadlines.size()), deadlines);
+    EXPECT_TRUE(fired);
+}
+
+TEST(TransactionPool, ConcurrentSubmit) {
+    const size_t producers_cnt = 8;
+    const Transaction tx_cnt = 10000;
+
+    // every producer submits all transactions, duplicates are dropped
+    TransactionPool pool;
+    std::vector<std::thread> producers;
+    for (size_t i = 0; i < producers_cnt; ++i) {
+        producers.emplace_back([&pool, i] {
+            for (Transaction tx = 1; tx <= tx_cnt; ++tx) {
+                if (i % 2 == 0) {
+                    pool.submit(tx);
+                } else {
+                    pool.submit(std::vector<Transaction>{tx});
+                }
+            }
+        });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+
+    std::vector<Transaction> taken = pool.take(2 * tx_cnt);
+    std::sort(taken.begin(), taken.end());
+    std::vector<Transaction> expected(tx_cnt);
+    std::iota(expected.begin(), expected.end(), 1);
+    EXPECT_EQ(taken, expected);
+    EXPECT_EQ(pool.size(), 0);
+
+    // the node takes transactions, while producers submit disjoint ranges
+    producers.clear();
+    for (size_t i = 0; i < producers_cnt; ++i) {
+        producers.emplace_back([&pool, i] {
+            for (Transaction tx = i * tx_cnt + 1; tx <= (i + 1) * tx_cnt; tx += 10) {
+                std::vector<Transaction> batch(10);
+                std::iota(batch.begin(), batch.end(), tx);
+                pool.submit(std::move(batch));
+            }
+        });
+    }
+
+    taken.clear();
+    while (taken.size() < producers_cnt * tx_cnt) {
+        std::vector<Transaction> txs = pool.take(100);
+        taken.insert(taken.end(), txs.begin(), txs.end());
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+
+    std::sort(taken.begin(), taken.end());
+    expected.resize(producers_cnt * tx_cnt);
+    std::iota(expected.begin(), expected.end(), 1);
+    EXPECT_EQ(taken, expected);
+
+    // node 0 of 7 replicates transactions of homes 5, 6 and 0, transactions of other homes are dropped
+    TransactionPool partitioned;
+    TxPartition partition{7, 3};
+    partitioned.set_partition(0, partition);
+    expected.clear();
+    for (Transaction tx = 1; tx <= 100; ++tx) {
+        partitioned.submit(tx);
+        if (partition.get_home(tx) >= 5 || partition.get_home(tx) == 0) {
+            expected.push_back(tx);
+        }
+    }
+    partitioned.return_tx({1, 2, 3, 4, 5, 6, 7});
+
+    taken = partitioned.take(200);
+    std::sort(taken.begin(), taken.end());
+    EXPECT_EQ(taken, expected);
+    EXPECT_EQ(partitioned.size(), 0);
+}
+
+TEST(Chain, ConflictIndex) {
+    // small range of ids, so proposals repeat transactions besides conflicts of their keys
+    std::mt19937_64 gen(42);
+    std::uniform_int_distribution<Transaction> rand_tx(1, 1000);
+    std::uniform_int_distribution<size_t> rand_batch(0, 50);
+    auto unique_key = [](Transaction tx) -> uint64_t { return tx; };
+
+    for (size_t run = 0; run < 100; ++run) {
+        std::vector<std::vector<Transaction>> proposals(7);
+        for (auto& proposal : proposals) {
+            proposal.resize(rand_batch(gen));
+            for (Transaction& tx : proposal) {
+                tx = rand_tx(gen);
+            }
+        }
+
+        // blocks are assembled by linear scans and by indexes of conflict_key and of keys, which never collide
+        Block scanned;
+        std::vector<Transaction> unique_scanned;
+        ConflictIndex index;
+        ConflictIndex unique_index(unique_key);
+        std::vector<Transaction> indexed;
+        std::vector<Transaction> unique_indexed;
+        for (auto& proposal : proposals) {
+            for (Transaction tx : proposal) {
+                if (!scanned.conflicts(tx)) {
+                    scanned.data.push_back(tx);
+                }
+                if (std::find(unique_scanned.begin(), unique_scanned.end(), tx) == unique_scanned.end()) {
+                    unique_scanned.push_back(tx);
+                }
+                if (!index.conflicts(tx)) {
+                    index.add(tx);
+                    indexed.push_back(tx);
+                }
+                if (!unique_index.conflicts(tx)) {
+                    unique_index.add(tx);
+                    unique_indexed.push_back(tx);
+                }
+            }
+        }
+
+        ASSERT_EQ(indexed, scanned.data);
+        ASSERT_EQ(unique_indexed, unique_scanned);
+        for (Transaction tx = 1; tx <= 1000; ++tx) {
+            ASSERT_EQ(index.conflicts(tx), scanned.conflicts(tx));
+        }
+    }
+}
+
+TEST(Chain, CommittedIndex) {
+    std::mt19937_64 gen(42);
+    CommittedIndex index;
+    std::unordered_set<Transaction> expected;
+    for (size_t block = 0; block < 300; ++block) {
+        std::vector<Transaction> txs;
+        for (size_t i = 0; i < 100; ++i) {
+            txs.push_back(gen() % 100000);
+        }
+        index.insert(txs);
+        expected.insert(txs.begin(), txs.end());
+        EXPECT_EQ(index.size(), expected.size());
+    }
+
+    index.wait_compaction();
+    EXPECT_LE(index.get_runs_cnt(), 8);
+    for (Transaction tx = 0; tx < 100000; ++tx) {
+        ASSERT_EQ(index.contains(tx), expected.contains(tx));
+    }
+}
+
+TEST(DBFT, VirtualNetwork) {
+    for (size_t n = 4; n < 32; n += 3) {
+        virtual_check(n, 0);
+        virtual_check(n, (n - 1) / 3);
+        virtual_check(n, (n - 1) / 3, TxRejector);
+    }
+}
+
+TEST(DBFT, VirtualNetworkIsDeterministic) {
+    auto run = [](uint64_t seed) {
+        VirtualNetwork net(seed);
+        SimulationConfig config = {
+            .sim_type = "Ok", .nodes = 10, .fail = 3, .shuffle = false,
+            .sim_data = {.max_blocks = 3, .batch_size = 5, .role = FailStop}
+        };
+        auto sim = run_virtual(net, config);
+
+        Node* node = sim->get_fair_node();
+        return std::make_pair(node->get_runtime(), node->get_metrics().rounds_number);
+    };
+
+    EXPECT_EQ(run(42), run(42));
+}
+
 
 int main(int argc, char **argv) {
     // FLAGS_log_dir = "./log";
@@ -1,14 +1,27 @@
 #include <gtest/gtest.h>
 
 #include <deque>
+#include <memory>
+#include <numeric>
+#include <iomanip>
 #include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
 
 #include <../src/core/message.hpp>
+#include <../src/core/digest.hpp>
+#include <../src/core/flat_map.hpp>
 #include <../src/network/netmanager.hpp>
 #include <../src/consensus/ReliableBroadcast.hpp>
+#include <../src/consensus/ErasureBroadcast.hpp>
 
 class FakeNetManager : public INetManager {
 public:
+  FakeNetManager(uint32_t id = 0) : id_(id) {
+  }
+
   void update_nodes() override {
   }
 
@@ -17,10 +30,11 @@ public:
   }
 
   uint32_t get_id() const override {
-    return 0;
+    return id_;
   }
 
-  void send(Message) override {
+  void send(Message msg) override {
+    sent.push_back(std::move(msg));
   }
 
   std::optional<Message> receive() {
@@ -33,7 +47,9 @@ public:
   void stop_receive() override {
   }
 
-  void broadcast(Message) override {
+  void broadcast(Message msg) override {
+    msg.to = -1;
+    sent.push_back(std::move(msg));
   }
 
   void close() override {
@@ -42,32 +58,53 @@ public:
   void set_timer(uint32_t, std::function<void()>) override {
   }
 
+  NetMetrics get_metrics() const override {
+    return {};
+  }
+
+  void run(std::function<void()> start) override {
+    start();
+  }
+
+  void join() override {
+  }
+
+  uint64_t now() const override {
+    return 0;
+  }
+
   void add_message(const Message& msg) {
     queue.push_back(std::move(msg));
   }
 
+  std::deque<Message> sent;
+
 private:
+  uint32_t id_;
   std::deque<Message> queue;
 };
 
+Message get_data(Transaction value) {
+  Message data;
+  data.data = make_proposal({value});
+  return data;
+}
+
 std::deque<Message> get_RB_msgs(int n, int t) {
-  static auto get_data = [](int value) { return json{{"value", value}}; };
   std::deque<Message> RB_msgs;
 
   for (int i = 0; i + t < n; ++i) {
-    RB_msgs.push_back(Message("RB_ECHO", get_data(0), i));
+    RB_msgs.push_back(Message(MessageType::RB_ECHO, get_data(0), i));
   }
 
   for (int i = 0; i + t < n; ++i) {
-    RB_msgs.push_back(Message("RB_READY", get_data(0), i));
+    RB_msgs.push_back(Message(MessageType::RB_READY, get_data(0), i));
   }
 
   return RB_msgs;
 }
 
 void sanity_check(int n, int t) {
-  static auto get_data = [](int value) { return json{{"value", value}}; };
-
   FakeNetManager net_manager;
   ReliableBroadcast RB(n, net_manager);
 
@@ -93,7 +130,7 @@ void sanity_check(int n, int t) {
   RB_msgs.pop_front();
   auto res = RB.process_msg(msg);
   ASSERT_NE(res, std::nullopt);
-  EXPECT_EQ(res.value(), get_data(0));
+  EXPECT_EQ(res.value().proposal(), get_data(0).proposal());
   EXPECT_EQ(RB.is_delivered(get_data(0)), true);
 }
 
@@ -105,8 +142,6 @@ TEST(ReliableBroadcast, JustWorks) {
 }
 
 void shuffle_check(int n, int t) {
-  static auto get_data = [](int value) { return json{{"value", value}}; };
-
   FakeNetManager net_manager;
   ReliableBroadcast RB(n, net_manager);
 
@@ -131,9 +166,32 @@ TEST(ReliableBroadcast, Shuffle) {
   }
 }
 
+// node ids from 64 on are out of the inline word of NodeSet
+TEST(ReliableBroadcast, LargeNetwork) {
+  for (size_t n : {64, 65, 128, 129, 256}) {
+    sanity_check(n, (n - 1) / 3);
+    shuffle_check(n, (n - 1) / 3);
+  }
+}
+
+TEST(ReliableBroadcast, UnknownSender) {
+  int n = 4, t = 1;
+
+  FakeNetManager net_manager;
+  ReliableBroadcast RB(n, net_manager);
+  RB.broadcast(get_data(0));
+
+  for (int i = 0; i + t < n; ++i) {
+    RB.process_msg(Message(MessageType::RB_ECHO, get_data(0), i));
+  }
+  for (int i = n; i < 2 * n; ++i) {
+    EXPECT_EQ(RB.process_msg(Message(MessageType::RB_READY, get_data(0), i)), std::nullopt);
+  }
+  EXPECT_EQ(RB.is_delivered(get_data(0)), false);
+}
+
 
 TEST(ReliableBroadcast, MultipleBroadcasts) {
-  auto get_data = [](int value) { return json{{"value", value}}; };
   int n = 10, t = 3;
 
   FakeNetManager net_manager;
@@ -145,59 +203,270 @@ TEST(ReliableBroadcast, MultipleBroadcasts) {
 
   for (int i = 0; i + t < n; ++i) {
     for (int value = 0; value < 3; ++value) {
-      auto res = RB.process_msg(Message("RB_ECHO", get_data(value), i));
+      auto res = RB.process_msg(Message(MessageType::RB_ECHO, get_data(value), i));
       EXPECT_EQ(res, std::nullopt);
     }
   }
 
   for (int i = 0; i + t + 1 < n; ++i) {
     for (int value = 0; value < 5; ++value) {
-      auto res = RB.process_msg(Message("RB_READY", get_data(value), i));
+      auto res = RB.process_msg(Message(MessageType::RB_READY, get_data(value), i));
       EXPECT_EQ(res, std::nullopt);
     }
   }
 
   for (int value = 0; value < 5; ++value) {
-    auto res = RB.process_msg(Message("RB_READY", get_data(value), n - 1));
+    auto res = RB.process_msg(Message(MessageType::RB_READY, get_data(value), n - 1));
     ASSERT_NE(res, std::nullopt);
-    EXPECT_EQ(res.value(), get_data(value));
+    EXPECT_EQ(res.value().proposal(), get_data(value).proposal());
   }
 }
 
 
 TEST(ReliableBroadcast, GetBroadcast) {
-  auto get_data = [](int value) { return json{{"value", value}}; };
   int n = 10, t = 3;
 
   FakeNetManager net_manager;
   ReliableBroadcast RB(n, net_manager);
 
   for (int i = 0; i + t < n; ++i) {
-    auto res = RB.process_msg(Message("RB_ECHO", get_data(0), i));
+    auto res = RB.process_msg(Message(MessageType::RB_ECHO, get_data(0), i));
     EXPECT_EQ(res, std::nullopt);
-    res = RB.process_msg(Message("RB_ECHO", get_data(1), i));
+    res = RB.process_msg(Message(MessageType::RB_ECHO, get_data(1), i));
     EXPECT_EQ(res, std::nullopt);
   }
 
   RB.broadcast(get_data(5));
 
   for (int i = 0; i + t + 1 < n; ++i) {
-    auto res = RB.process_msg(Message("RB_READY", get_data(5), i));
+    auto res = RB.process_msg(Message(MessageType::RB_READY, get_data(5), i));
+    EXPECT_EQ(res, std::nullopt);
+
+    res = RB.process_msg(Message(MessageType::RB_READY, get_data(0), i));
+    EXPECT_EQ(res, std::nullopt);
+  }
+
+  auto res = RB.process_msg(Message(MessageType::RB_READY, get_data(5), n - 1));
+  ASSERT_NE(res, std::nullopt);
+  EXPECT_EQ(res.value().proposal(), get_data(5).proposal());
+
+  res = RB.process_msg(Message(MessageType::RB_READY, get_data(0), n - 1));
+  ASSERT_NE(res, std::nullopt);
+  EXPECT_EQ(res.value().proposal(), get_data(0).proposal());
+}
+
+
+Message find_sent(const FakeNetManager& net_manager, MessageType type) {
+  for (const auto& msg : net_manager.sent) {
+    if (msg.type == type) {
+      return msg;
+    }
+  }
+  return Message();
+}
+
+TEST(ReliableBroadcast, DigestEchoReady) {
+  int n = 10, t = 3;
+
+  FakeNetManager net_manager;
+  ReliableBroadcast RB(n, net_manager, RBMode::Digest);
+
+  auto res = RB.process_msg(Message(MessageType::RB_INIT, get_data(7), 0));
+  EXPECT_EQ(res, std::nullopt);
+
+  Message echo = find_sent(net_manager, MessageType::RB_ECHO);
+  ASSERT_EQ(echo.type, MessageType::RB_ECHO);
+  ASSERT_TRUE(echo.has_digest());
+
+  for (int i = 0; i + t < n; ++i) {
+    res = RB.process_msg(Message(MessageType::RB_ECHO, echo, i));
     EXPECT_EQ(res, std::nullopt);
+  }
+
+  Message ready = find_sent(net_manager, MessageType::RB_READY);
+  ASSERT_EQ(ready.type, MessageType::RB_READY);
+  ASSERT_TRUE(ready.has_digest());
 
-    res = RB.process_msg(Message("RB_READY", get_data(0), i));
+  for (int i = 0; i + t + 1 < n; ++i) {
+    res = RB.process_msg(Message(MessageType::RB_READY, ready, i));
     EXPECT_EQ(res, std::nullopt);
   }
 
-  auto res = RB.process_msg(Message("RB_READY", get_data(5), n - 1));
+  res = RB.process_msg(Message(MessageType::RB_READY, ready, n - 1));
   ASSERT_NE(res, std::nullopt);
-  EXPECT_EQ(res.value(), get_data(5));
+  EXPECT_EQ(res.value().proposal(), get_data(7).proposal());
+  EXPECT_EQ(find_sent(net_manager, MessageType::RB_FETCH).type, MessageType::Undefined);
+}
+
+TEST(ReliableBroadcast, DigestFetchPayload) {
+  int n = 10, t = 3;
+
+  // node, that received the payload, answers the fetch request
+  FakeNetManager proposer_net;
+  ReliableBroadcast proposer_RB(n, proposer_net, RBMode::Digest);
+  proposer_RB.broadcast(get_data(7));
+  proposer_RB.process_msg(Message(MessageType::RB_INIT, get_data(7), 0));
+  Message ready = Message(MessageType::RB_READY, find_sent(proposer_net, MessageType::RB_ECHO));
 
-  res = RB.process_msg(Message("RB_READY", get_data(0), n - 1));
+  // node, that missed RB_INIT, knows the payload only by digest
+  FakeNetManager net_manager;
+  ReliableBroadcast RB(n, net_manager, RBMode::Digest);
+
+  for (int i = 0; i + t < n; ++i) {
+    auto res = RB.process_msg(Message(MessageType::RB_READY, ready, i));
+    EXPECT_EQ(res, std::nullopt);
+  }
+
+  Message fetch = find_sent(net_manager, MessageType::RB_FETCH);
+  ASSERT_EQ(fetch.type, MessageType::RB_FETCH);
+  fetch.from = 5;
+
+  proposer_RB.process_msg(fetch);
+  Message payload = find_sent(proposer_net, MessageType::RB_PAYLOAD);
+  ASSERT_EQ(payload.type, MessageType::RB_PAYLOAD);
+  EXPECT_EQ(payload.to, 5);
+
+  auto res = RB.process_msg(payload);
   ASSERT_NE(res, std::nullopt);
-  EXPECT_EQ(res.value(), get_data(0));
+  EXPECT_EQ(res.value().proposal(), get_data(7).proposal());
+  EXPECT_EQ(RB.is_delivered(get_data(7)), true);
 }
 
+TEST(ErasureBroadcast, JustWorks) {
+  for (int n = 4; n < 50; n += 3) {
+    int t = (n - 1) / 3;
+    std::vector<std::unique_ptr<FakeNetManager>> net_managers;
+    std::vector<std::unique_ptr<ErasureBroadcast>> AVIDs;
+    for (int i = 0; i < n; ++i) {
+      net_managers.push_back(std::make_unique<FakeNetManager>(i));
+      AVIDs.push_back(std::make_unique<ErasureBroadcast>(n, *net_managers[i]));
+    }
+
+    std::vector<Transaction> tx(100);
+    std::iota(tx.begin(), tx.end(), 1);
+    Message data;
+    data.data = make_proposal(tx);
+    AVIDs[0]->broadcast(data);
+
+    // deliver all messages, except messages of t silent nodes
+    std::vector<std::optional<Message>> results(n);
+    bool sent = true;
+    while (sent) {
+      sent = false;
+      for (int from = 0; from + t < n; ++from) {
+        auto& queue = net_managers[from]->sent;
+        while (!queue.empty()) {
+          sent = true;
+          Message msg = std::move(queue.front());
+          queue.pop_front();
+          msg.from = from;
+
+          for (int to = 0; to + t < n; ++to) {
+            if (msg.to != -1 && msg.to != to) {
+              continue;
+            }
+            auto res = AVIDs[to]->process_msg(msg);
+            if (res.has_value()) {
+              EXPECT_EQ(results[to], std::nullopt);
+              results[to] = res;
+            }
+          }
+        }
+      }
+    }
+
+    for (int i = 0; i + t < n; ++i) {
+      ASSERT_NE(results[i], std::nullopt);
+      EXPECT_EQ(results[i].value().proposal().transactions, tx);
+    }
+  }
+}
+
+
+std::string to_hex(const Digest& digest) {
+  std::ostringstream out;
+  for (uint8_t byte : digest) {
+    out << std::hex << std::setw(2) << std::setfill('0') << uint32_t(byte);
+  }
+  return out.str();
+}
+
+// FIPS 180-2 examples
+TEST(Sha256, KnownAnswers) {
+  std::vector<std::pair<std::string, std::string>> vectors = {
+    {"", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"},
+    {"abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"},
+    // 56 bytes, the padding goes to the second block
+    {"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+     "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"},
+  };
+
+  for (auto& [message, expected] : vectors) {
+    EXPECT_EQ(to_hex(sha256(message.data(), message.size())), expected);
+
+    // fed by chunks of one byte
+    Sha256 hasher;
+    for (char c : message) {
+      hasher.update(c);
+    }
+    EXPECT_EQ(to_hex(hasher.finalize()), expected);
+  }
+
+  // one million of 'a', fed by chunks crossing the blocks
+  std::string chunk(1000, 'a');
+  Sha256 hasher;
+  for (int i = 0; i < 1000; ++i) {
+    hasher.update(chunk.data(), chunk.size());
+  }
+  EXPECT_EQ(to_hex(hasher.finalize()), "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+}
+
+// few distinct hashes make long probe sequences, which wrap around the end of the slots
+struct CollidingHash {
+  size_t operator()(uint32_t key) const {
+    return key % 7 * 1000003;
+  }
+};
+
+template <typename Hash>
+void check_flat_map() {
+  std::mt19937 gen(42);
+  FlatHashMap<uint32_t, uint32_t, Hash> map;
+  std::unordered_map<uint32_t, uint32_t> expected;
+  for (int i = 0; i < 100000; ++i) {
+    uint32_t key = gen() % 300;
+    if (gen() % 2 == 0) {
+      auto [value, inserted] = map.try_emplace(key, i);
+      EXPECT_EQ(inserted, expected.try_emplace(key, i).second);
+      EXPECT_EQ(value, expected.at(key));
+    } else {
+      EXPECT_EQ(map.erase(key), expected.erase(key) == 1);
+    }
+
+    if (i % 1000 == 0) {
+      ASSERT_EQ(map.size(), expected.size());
+      for (uint32_t k = 0; k < 300; ++k) {
+        uint32_t* value = map.find(k);
+        auto it = expected.find(k);
+        ASSERT_EQ(value != nullptr, it != expected.end());
+        ASSERT_EQ(map.contains(k), it != expected.end());
+        if (value) {
+          EXPECT_EQ(*value, it->second);
+        }
+      }
+    }
+  }
+
+  map.clear();
+  EXPECT_TRUE(map.empty());
+  EXPECT_FALSE(map.contains(0));
+}
+
+// backward shift deletion keeps every key reachable from its home slot
+TEST(FlatHashMap, MatchesUnorderedMap) {
+  check_flat_map<std::hash<uint32_t>>();
+  check_flat_map<CollidingHash>();
+}
 
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);